@@ -0,0 +1,98 @@
+#ifndef ChargeProfile_h
+#define ChargeProfile_h
+
+#include "config.h"
+
+#define CHARGE_MAX_STAGES       5       // max number of stages in a profile
+#define CHARGE_STAGE_NONE       0xFF    // no stage transition
+#define CHARGE_STAGE_FAULT      0xFE    // transition to this stage stops the charging with CHARGING_REPLACE_BATTERY
+
+const unsigned long CHARGE_TICKS_PER_MIN = 60UL * TIMER_ONE_SEC;
+
+enum ChargeProfileId {
+    CHARGE_PROFILE_FLOODED,
+    CHARGE_PROFILE_AGM,
+    CHARGE_PROFILE_LIFEPO4,
+    CHARGE_PROFILE_CUSTOM,          // uploaded over serial, kept in EEPROM
+    CHARGE_NUM_PROFILES
+};
+
+#define CHARGE_NUM_BUILTIN_PROFILES CHARGE_PROFILE_CUSTOM
+
+// quantity regulated during the stage
+enum ChargeQuantity {
+    CHARGE_OFF,                     // output is off, only the exit conditions are checked
+    CHARGE_CURRENT,
+    CHARGE_VOLTAGE,
+    CHARGE_NUM_QUANTITIES
+};
+
+// exit conditions of the stage, any of them triggers the transition to the next stage
+enum ChargeExit {
+    CHARGE_EXIT_CURRENT_BELOW = 1,
+    CHARGE_EXIT_CURRENT_ABOVE = 2,
+    CHARGE_EXIT_VOLTAGE_ABOVE = 4,
+    CHARGE_EXIT_VOLTAGE_BELOW = 8,
+    CHARGE_EXIT_TIME = 16,
+    CHARGE_EXIT_DVDT = 32           // voltage change per minute is below the threshold
+};
+
+// fields of the stage, in the order of the upload command
+enum ChargeStageField {
+    CHARGE_FIELD_QUANTITY,
+    CHARGE_FIELD_EXIT,
+    CHARGE_FIELD_SETPOINT,
+    CHARGE_FIELD_EXIT_CURRENT,
+    CHARGE_FIELD_EXIT_VOLTAGE,
+    CHARGE_FIELD_EXIT_DVDT,
+    CHARGE_FIELD_DURATION,
+    CHARGE_FIELD_TIMEOUT,
+    CHARGE_FIELD_NEXT,
+    CHARGE_FIELD_ON_TIMEOUT,
+    CHARGE_NUM_FIELDS
+};
+
+/**
+ * @brief ChargeStage is a row of the charge profile table. Voltages are in mV per cell (12V block),
+ *        currents are in 1/1000 of the battery capacity (C), times are in minutes.
+ */
+struct ChargeStage {
+    uint8_t quantity;           // ChargeQuantity
+    uint8_t exit;               // ChargeExit flags
+    int16_t setpoint;           // target voltage or current, depending on the quantity
+    int16_t exit_current;       // threshold for CHARGE_EXIT_CURRENT_*
+    int16_t exit_voltage;       // threshold for CHARGE_EXIT_VOLTAGE_*
+    int16_t exit_dvdt;          // threshold for CHARGE_EXIT_DVDT, mV per cell per minute
+    uint16_t duration;          // stage duration for CHARGE_EXIT_TIME
+    uint16_t timeout;           // 0 - no timeout
+    uint8_t next;               // stage on exit
+    uint8_t on_timeout;         // stage on timeout
+};
+
+#define CHARGE_MV(v)  ( (int16_t)( (v) * 1000 + 0.5 ) )
+#define CHARGE_MC(c)  ( (int16_t)( (c) * 1000 + 0.5 ) )
+
+const PROGMEM ChargeStage CHARGE_PROFILES[CHARGE_NUM_BUILTIN_PROFILES][CHARGE_MAX_STAGES] = {
+    // Flooded lead acid: bulk -> absorption -> float
+    {
+        { CHARGE_CURRENT, CHARGE_EXIT_VOLTAGE_ABOVE | CHARGE_EXIT_DVDT, CHARGE_MC(0.1), 0,
+          CHARGE_MV(INTERACTIVE_MAX_V_BAT_CELL), -5, 0, 600, 1, CHARGE_STAGE_FAULT },
+        { CHARGE_VOLTAGE, CHARGE_EXIT_CURRENT_BELOW | CHARGE_EXIT_TIME, CHARGE_MV(INTERACTIVE_MAX_V_BAT_CELL), CHARGE_MC(0.02),
+          0, 0, 480, 0, 2, 2 },
+        { CHARGE_VOLTAGE, 0, CHARGE_MV(INTERACTIVE_STBY_V_BAT_CELL), 0, 0, 0, 0, 0, 2, 2 }
+    },
+    // AGM: bulk -> absorption -> float
+    {
+        { CHARGE_CURRENT, CHARGE_EXIT_VOLTAGE_ABOVE, CHARGE_MC(0.2), 0, CHARGE_MV(14.7), 0, 0, 600, 1, CHARGE_STAGE_FAULT },
+        { CHARGE_VOLTAGE, CHARGE_EXIT_CURRENT_BELOW | CHARGE_EXIT_TIME, CHARGE_MV(14.7), CHARGE_MC(0.01), 0, 0, 480, 0, 2, 2 },
+        { CHARGE_VOLTAGE, 0, CHARGE_MV(13.6), 0, 0, 0, 0, 0, 2, 2 }
+    },
+    // LiFePO4 (4S per 12V block): CC -> CV -> rest till the voltage drops, no float
+    {
+        { CHARGE_CURRENT, CHARGE_EXIT_VOLTAGE_ABOVE, CHARGE_MC(0.2), 0, CHARGE_MV(14.4), 0, 0, 480, 1, CHARGE_STAGE_FAULT },
+        { CHARGE_VOLTAGE, CHARGE_EXIT_CURRENT_BELOW | CHARGE_EXIT_TIME, CHARGE_MV(14.4), CHARGE_MC(0.05), 0, 0, 60, 0, 2, 2 },
+        { CHARGE_OFF, CHARGE_EXIT_VOLTAGE_BELOW, 0, 0, CHARGE_MV(13.3), 0, 0, 0, 0, 0 }
+    }
+};
+
+#endif
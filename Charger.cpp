@@ -1,7 +1,8 @@
 #include "Charger.h"
 
 
-Charger::Charger(Settings* settings, Sensor* current_sensor, Sensor* voltage_sensor, Print* dbg) {
+Charger::Charger(Settings* settings, Sensor* current_sensor, Sensor* voltage_sensor, Print* dbg) :
+    _pid(0, MAXCOUT) {
 
     set_current_sensor(current_sensor);
     set_voltage_sensor(voltage_sensor);
@@ -12,27 +13,63 @@ Charger::Charger(Settings* settings, Sensor* current_sensor, Sensor* voltage_sen
     _settings = settings;
     _dbg = dbg;
 
+    _min_battery_voltage = INTERACTIVE_MIN_V_BAT;
+    set_battery( INTERACTIVE_BATTERY_AH * INTERACTIVE_NUM_BATTERY_PACKS, INTERACTIVE_NUM_CELLS );
+
+    _profile = CHARGER_DEFAULT_PROFILE;
+    _stage = 0;
+    memset(&_stage_data, 0x0, sizeof(ChargeStage));
+    memcpy_P(_custom_profile, CHARGE_PROFILES[CHARGER_DEFAULT_PROFILE], sizeof(_custom_profile));
+
     k[CHARGING_KP] = 400.0;
     k[CHARGING_KI] = 0.02;
     k[CHARGING_KD] = 50.0; 
     k[CHARGING_TEST] = 0;
+    k[CHARGING_DERIVATIVE_MODE] = PID_DERIVATIVE_ON_MEASUREMENT;
+
+    apply_params();
 
     set_charging(false);       
 }
 
-void Charger::start(float current, float voltage, unsigned long ticks) {
+void Charger::start(unsigned long ticks) {
     if(_charging) return;
 
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _last_ticks = ticks;
+
+        set_charging(true);
+
+        _charging_mode = CHARGING_NOT_STARTED;
+        enter_stage(0, ticks);
+    }
+}
+
+void Charger::autotune(float current, float voltage, unsigned long ticks) {
+    if(_charging || current <= 0.0F || voltage <= 0.0F) return;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+
     set_current(current);
     set_voltage(voltage);
 
     _last_ticks = ticks;
-    _last_deviation = 0;
-    _deviation_sum = 0;
 
     set_charging(true);
 
-    _charging_mode = CHARGING_BY_CC;
+    _charging_mode = CHARGING_AUTOTUNE;
+
+    _tune_start = ticks;
+    _tune_last_switch = ticks;
+    _tune_high = true;
+    _tune_switches = 0;
+    _tune_cycles = 0;
+    _tune_max = -INFINITY;
+    _tune_min = INFINITY;
+    _tune_period_sum = 0;
+    _tune_amplitude_sum = 0;
+
+    }
 }
 
 void Charger::set_current(float current) {
@@ -44,20 +81,25 @@ void Charger::set_current(float current) {
     _charging_current = current;
 }
 
-void Charger::regulate(unsigned long ticks) {
+void Charger::regulate(unsigned long ticks, uint16_t latency) {
+
+    // measure the jitter of the regulation period
+    unsigned long call_us = ticks * CHARGER_US_PER_TICK + latency;
+    if( _last_call_us ) {
+        long deviation = (long)( call_us - _last_call_us ) - (long) CHARGER_REGULATE_PERIOD * CHARGER_US_PER_TICK;
+        _jitter = max( _jitter, (uint16_t) min( abs(deviation), 0xFFFFL ) );
+    }
+    _last_call_us = call_us;
+    _regulate_ticks = ticks;
 
     if(!_charging) return;   
 
-    if( !(_charging_mode == CHARGING_BY_CC || _charging_mode == CHARGING_BY_CV || _charging_mode == CHARGING_COMPLETE) )  {
+    if( !(_charging_mode == CHARGING_BY_CC || _charging_mode == CHARGING_BY_CV || 
+          _charging_mode == CHARGING_COMPLETE || _charging_mode == CHARGING_AUTOTUNE) )  {
         set_charging(false);
         return;
     }
     
-    if( _charging_current <= _cutoff_current || _charging_voltage <= 0.0 ) {
-        _charging_mode = CHARGING_TARGET_NOT_SET;
-        set_charging(false);
-        return;                          
-    }
     if(_current_sensor == NULL) {
         _charging_mode = CHARGING_C_SENSOR_NOT_SET; 
         set_charging(false);
@@ -87,121 +129,440 @@ void Charger::regulate(unsigned long ticks) {
         return;
     }
 
-    // if voltage is reaching target, switch to CV charging 
-    float charge_to_full = (float)( _charging_voltage - reading_v )/(_charging_voltage - _min_battery_voltage);    
-    if(charge_to_full < 0 && _charging_mode == CHARGING_BY_CC ) {
-        _charging_mode = CHARGING_BY_CV;    
+    if(_charging_mode == CHARGING_AUTOTUNE) {
+        autotune_step(reading_c, reading_v, ticks);
+        return;
     }
-    
-    float deviation = 0.0F;
 
-    switch(_charging_mode) {
-        case CHARGING_BY_CC:
-            deviation = (_charging_current - reading_c)/_charging_current;
-            break;
-        case CHARGING_BY_CV:
-            // check if the charging is complete
-            if( reading_c <= _cutoff_current ) {
-                _charging_mode = CHARGING_COMPLETE;   
-                _charging_voltage = INTERACTIVE_STBY_V_BAT;      
-            }
+    uint8_t next = evaluate_stage(reading_c, reading_v, ticks);
+    if( next != CHARGE_STAGE_NONE ) {
+        enter_stage(next, ticks);
+        if( !_charging ) return;
+    }
     
-            deviation = ( _charging_voltage - reading_v )/_charging_voltage;
+    // measurement relative to the target
+    float measurement = 0.0F;
+
+    switch(_stage_data.quantity) {
+        case CHARGE_CURRENT:
+            measurement = reading_c / _charging_current;
             break;
-        case CHARGING_COMPLETE:
-            deviation = ( _charging_voltage - reading_v )/_charging_voltage;
-            // if( reading_c > 2.0F * _cutoff_current ) {
-            //     _charging_mode = CHARGING_REPLACE_BATTERY;      
-            // }
+        case CHARGE_VOLTAGE:
+            measurement = reading_v / _charging_voltage;
             break;
         default:
-            set_charging(false);
+            // output is off till the exit condition
+            _cout_regv = 0;
+            pwmSet10(0);
+            _last_deviation = 0.0F;
+            _last_ticks = ticks;
             return;
-            break;
     }
 
-    long elapsed_ticks = 1; // @todo: switch to actual time?
+    float deviation = 1.0F - measurement;
 
-    // update the integrator component
-    _deviation_sum += ( deviation * elapsed_ticks );
+    unsigned long elapsed_ticks = ticks - _last_ticks;
+
+    // the gains are defined per regulation period, the elapsed time is rounded to the periods
+    unsigned long elapsed_periods = ( elapsed_ticks + CHARGER_REGULATE_PERIOD / 2 ) / CHARGER_REGULATE_PERIOD;
 
     // calculate the regulator output
-    _cout_regv = round( k[CHARGING_KP] * deviation + 
-                        k[CHARGING_KI] * _deviation_sum + 
-                        k[CHARGING_KD] * (deviation - _last_deviation) / elapsed_ticks +
-                        k[CHARGING_TEST] );
+    _cout_regv = _pid.compute( (int32_t) round( deviation * PID_ONE ),
+                               (int32_t) round( measurement * PID_ONE ),
+                               (uint16_t) min( elapsed_periods, 0xFFFFUL ) );
+
+    pwmSet10(_cout_regv);
+
+    _last_deviation = deviation;
+    _elapsed_ticks = elapsed_ticks;
+    _last_ticks = ticks;
+
+
+    return;
+}
+
+uint8_t Charger::evaluate_stage(float reading_c, float reading_v, unsigned long ticks) {
+
+    unsigned long elapsed = ticks - _stage_start;
+    uint8_t exit = _stage_data.exit;
+
+    if( _stage_data.timeout && elapsed >= _stage_data.timeout * CHARGE_TICKS_PER_MIN )
+        return _stage_data.on_timeout;
+
+    if( ( ( exit & CHARGE_EXIT_CURRENT_BELOW ) && reading_c <= _exit_current ) ||
+        ( ( exit & CHARGE_EXIT_CURRENT_ABOVE ) && reading_c >= _exit_current ) ||
+        ( ( exit & CHARGE_EXIT_VOLTAGE_ABOVE ) && reading_v >= _exit_voltage ) ||
+        ( ( exit & CHARGE_EXIT_VOLTAGE_BELOW ) && reading_v <= _exit_voltage ) ||
+        ( ( exit & CHARGE_EXIT_TIME ) && elapsed >= _stage_data.duration * CHARGE_TICKS_PER_MIN ) )
+        return _stage_data.next;
+
+    // voltage change per minute, in mV per cell
+    if( ( exit & CHARGE_EXIT_DVDT ) && ticks - _dvdt_ticks >= CHARGE_TICKS_PER_MIN ) {
+        float dvdt = ( reading_v - _dvdt_voltage ) * 1000.0F / _num_cells * 
+                     CHARGE_TICKS_PER_MIN / ( ticks - _dvdt_ticks );
+        _dvdt_voltage = reading_v;
+        _dvdt_ticks = ticks;
 
-    // Applying regulator threshold
-    if( _cout_regv >= MAXCOUT ) {
-        _cout_regv = MAXCOUT;                  
+        if( dvdt <= _stage_data.exit_dvdt ) 
+            return _stage_data.next;
     }
-    else if( _cout_regv <= 0 ) {
-        _cout_regv = 0;             
+
+    return CHARGE_STAGE_NONE;
+}
+
+void Charger::enter_stage(uint8_t stage, unsigned long ticks) {
+    if( stage == CHARGE_STAGE_FAULT ) {
+        set_charging(false);
+        _charging_mode = CHARGING_REPLACE_BATTERY;
+        return;
     }
 
-    pwmSet10(_cout_regv);
+    if( stage >= CHARGE_MAX_STAGES ) {
+        set_charging(false);
+        _charging_mode = CHARGING_TARGET_NOT_SET;
+        return;
+    }
 
-    _last_deviation = deviation;
+    // the integral is kept for the bumpless transition, the derivative is restarted for the new quantity
+    _pid.restartDerivative();
+
+    ChargeStage data;
+    read_stage(_profile, stage, &data);
+
+    _stage = stage;
+    _stage_data = data;
+    _stage_start = ticks;
+
+    _exit_current = data.exit_current * _capacity / 1000.0F;
+    _exit_voltage = data.exit_voltage * _num_cells / 1000.0F;
+
+    _dvdt_voltage = _voltage_sensor ? _voltage_sensor->reading() : 0.0F;
+    _dvdt_ticks = ticks;
+
+    switch( data.quantity ) {
+        case CHARGE_CURRENT:
+            _charging_current = data.setpoint * _capacity / 1000.0F;
+            _charging_mode = CHARGING_BY_CC;
+            break;
+        case CHARGE_VOLTAGE:
+            _charging_voltage = data.setpoint * _num_cells / 1000.0F;
+            // the last stage with no exit is maintaining the charged battery
+            _charging_mode = data.exit ? CHARGING_BY_CV : CHARGING_COMPLETE;
+            break;
+        case CHARGE_OFF:
+            _charging_mode = CHARGING_COMPLETE;
+            break;
+        default:
+            _charging_mode = CHARGING_TARGET_NOT_SET;
+            set_charging(false);
+            return;
+    }
+
+    if( data.quantity != CHARGE_OFF && data.setpoint <= 0 ) {
+        _charging_mode = CHARGING_TARGET_NOT_SET;
+        set_charging(false);
+    }
+}
+
+void Charger::autotune_step(float reading_c, float reading_v, unsigned long ticks) {
+
+    _last_deviation = ( _charging_current - reading_c ) / _charging_current;
     _elapsed_ticks = ticks - _last_ticks;
     _last_ticks = ticks;
 
+    // keep the experiment within the voltage and time limits
+    if( reading_v >= _charging_voltage || ticks - _tune_start > CHARGER_AUTOTUNE_TIMEOUT ) {
+        set_charging(false);
+        _charging_mode = CHARGING_AUTOTUNE_FAILED;
+        return;
+    }
 
-    return;
+    _tune_max = max(_tune_max, reading_c);
+    _tune_min = min(_tune_min, reading_c);
+
+    float hysteresis = CHARGER_AUTOTUNE_HYSTERESIS * _charging_current;
+
+    if( _tune_high && reading_c > _charging_current + hysteresis ) {
+        _tune_high = false;
+    }
+    else if( !_tune_high && reading_c < _charging_current - hysteresis ) {
+        _tune_high = true;
+
+        // a full oscillation ends on the low->high switch. The first one is skipped as a transient.
+        if( ++_tune_switches > 1 ) {
+            _tune_period_sum += ticks - _tune_last_switch;
+            _tune_amplitude_sum += ( _tune_max - _tune_min ) / 2;
+            _tune_cycles++;
+        }
+
+        _tune_last_switch = ticks;
+        _tune_max = _tune_min = reading_c;
+
+        if( _tune_cycles >= CHARGER_AUTOTUNE_CYCLES ) {
+            autotune_finish(ticks);
+            return;
+        }
+    }
+
+    _cout_regv = _tune_high ? CHARGER_AUTOTUNE_OUTPUT : 0;
+    pwmSet10(_cout_regv);
+}
+
+void Charger::autotune_finish(unsigned long ticks) {
+
+    // oscillation amplitude relative to the target, as seen by the PID, and period in the regulation periods
+    float amplitude = _tune_amplitude_sum / _tune_cycles / _charging_current;
+    float period = _tune_period_sum / _tune_cycles / CHARGER_REGULATE_PERIOD;
+
+    if( amplitude <= 0.0F || period <= 0.0F ) {
+        set_charging(false);
+        _charging_mode = CHARGING_AUTOTUNE_FAILED;
+        return;
+    }
+
+    // ultimate gain of the relay feedback
+    float ku = 4.0F * ( CHARGER_AUTOTUNE_OUTPUT / 2.0F ) / ( PI * amplitude );
+
+    // Ziegler-Nichols "no overshoot" rule: Kp = 0.2Ku, Ti = Pu/2, Td = Pu/3
+    float kp = 0.2F * ku;
+    float ki = kp / ( period / 2.0F );
+    float kd = kp * ( period / 3.0F );
+
+    // the gains out of the fixed point range would be clamped by the PID, the old ones are kept
+    if( kp > PID_MAX_KP || ki > PID_MAX_KI || kd > PID_MAX_KD ) {
+        set_charging(false);
+        _charging_mode = CHARGING_AUTOTUNE_FAILED;
+        return;
+    }
+
+    k[CHARGING_KP] = kp;
+    k[CHARGING_KI] = ki;
+    k[CHARGING_KD] = kd;
+    apply_params();
+
+    // EEPROM write is too slow for the interrupt, defer it to the loop
+    _save_pending = true;
+
+    // continue charging by the profile with the new params
+    _pid.reset();
+    enter_stage(0, ticks);
 }
 
 void Charger::stop() {
     // if(!_charging) return;
     
-    _charging_mode = CHARGING_NOT_STARTED;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _charging_mode = CHARGING_NOT_STARTED;
 
-    _last_deviation = 0.0F;
-    _last_ticks = 0;
-    
-    set_charging(false);
+        _last_deviation = 0.0F;
+        _last_ticks = 0;
+        
+        set_charging(false);
+    }
+
+}
+
+void Charger::service() {
+    if(_save_pending) {
+        _save_pending = false;
+        saveParams();
+    }
+}
+
+void Charger::set_profile(uint8_t profile) {
+    if( profile >= CHARGE_NUM_PROFILES ) return;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _profile = profile;
+
+        if( _charging && _charging_mode != CHARGING_AUTOTUNE ) 
+            enter_stage(0, _regulate_ticks);
+    }
+}
 
+void Charger::read_stage(uint8_t profile, uint8_t stage, ChargeStage* data) {
+    if( stage >= CHARGE_MAX_STAGES ) {
+        memset(data, 0x0, sizeof(ChargeStage));
+        return;
+    }
+
+    if( profile < CHARGE_NUM_BUILTIN_PROFILES ) 
+        memcpy_P(data, &CHARGE_PROFILES[profile][stage], sizeof(ChargeStage));
+    else 
+        *data = _custom_profile[stage];
 }
 
+void Charger::set_custom_stage(uint8_t stage, uint8_t field, int16_t value) {
+    if( stage >= CHARGE_MAX_STAGES ) return;
+
+    ChargeStage data;
+    read_stage(CHARGE_PROFILE_CUSTOM, stage, &data);
+
+    switch( field ) {
+        case CHARGE_FIELD_QUANTITY:     data.quantity = value; break;
+        case CHARGE_FIELD_EXIT:         data.exit = value; break;
+        case CHARGE_FIELD_SETPOINT:     data.setpoint = value; break;
+        case CHARGE_FIELD_EXIT_CURRENT: data.exit_current = value; break;
+        case CHARGE_FIELD_EXIT_VOLTAGE: data.exit_voltage = value; break;
+        case CHARGE_FIELD_EXIT_DVDT:    data.exit_dvdt = value; break;
+        case CHARGE_FIELD_DURATION:     data.duration = value; break;
+        case CHARGE_FIELD_TIMEOUT:      data.timeout = value; break;
+        case CHARGE_FIELD_NEXT:         data.next = value; break;
+        case CHARGE_FIELD_ON_TIMEOUT:   data.on_timeout = value; break;
+        default: return;
+    }
+
+    save_custom_profile(_settings->getAddr(SETTINGS_PROFILE), stage, &data);
+
+    // the stage is replaced while the interrupt may be reading it
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _custom_profile[stage] = data;
+    }
+}
+
+void Charger::load_custom_profile() {
+    // the custom profile falls back to the default one if its block is not valid
+    int addr = _settings->getAddr(SETTINGS_PROFILE);
+
+    ChargeStage data;
+    for( uint8_t s = 0; s < CHARGE_MAX_STAGES; s++ ) {
+        if( addr >= 0 )
+            EEPROM.get(addr + s * sizeof(ChargeStage), data);
+        else
+            memcpy_P(&data, &CHARGE_PROFILES[CHARGER_DEFAULT_PROFILE][s], sizeof(ChargeStage));
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            _custom_profile[s] = data;
+        }
+    }
+}
+
+void Charger::print_profile(Print* stream) {
+    ChargeStage data;
+    for( uint8_t s = 0; s < CHARGE_MAX_STAGES; s++ ) {
+        read_stage(_profile, s, &data);
+        ex_format(stream, '(', _profile, ' ', s, ' ',
+                          data.quantity, ' ', data.exit, ' ', data.setpoint, ' ',
+                          data.exit_current, ' ', data.exit_voltage, ' ', data.exit_dvdt, ' ',
+                          data.duration, ' ', data.timeout, ' ',
+                          data.next, ' ', data.on_timeout, "\r\n");
+    }
+}
+
+void Charger::save_custom_profile(int from, uint8_t stage, const ChargeStage* data) {
+    // the whole profile is copied to the other slot of the block, so the stages are replaced atomically
+    int addr = _settings->create(SETTINGS_PROFILE);
+
+    ChargeStage stage_data;
+    for( uint8_t s = 0; s < CHARGE_MAX_STAGES; s++ ) {
+        if( s == stage ) 
+            stage_data = *data;
+        else if( from >= 0 ) 
+            EEPROM.get(from + s * sizeof(ChargeStage), stage_data);
+        else 
+            memcpy_P(&stage_data, &CHARGE_PROFILES[CHARGER_DEFAULT_PROFILE][s], sizeof(ChargeStage));
+
+        EEPROM.put(addr + s * sizeof(ChargeStage), stage_data);
+    }
+
+    _settings->commit( SETTINGS_PROFILE, CHARGE_MAX_STAGES * sizeof(ChargeStage) );
+}
+
+static_assert( sizeof(uint8_t) + CHARGING_NUMPARAM * sizeof(float) <= SETTINGS_BLOCK_SIZE[SETTINGS_CHARGER], "Charger params do not fit the settings block" );
+static_assert( CHARGE_MAX_STAGES * sizeof(ChargeStage) <= SETTINGS_BLOCK_SIZE[SETTINGS_PROFILE], "Custom profile does not fit the settings block" );
+
 void Charger::loadParams() {
-    long addr = _settings->getAddr(SETTINGS_CHARGER);
+    int addr = _settings->open(SETTINGS_CHARGER);
+    int legacy_stages = -1;
+
+    if( addr >= 0 ) {
+        uint8_t profile = CHARGER_DEFAULT_PROFILE;
+        EEPROM.get(addr, profile);
+        _profile = ( profile < CHARGE_NUM_PROFILES ) ? profile : CHARGER_DEFAULT_PROFILE;
+        addr += sizeof(uint8_t);
+
+        // params saved by an older firmware are loaded, the new ones keep defaults 
+        uint8_t num_params = min( ( _settings->getSize(SETTINGS_CHARGER) - (int) sizeof(uint8_t) ) / (int) sizeof(float), CHARGING_NUMPARAM );
+        read_params(addr, num_params);
+    }
+    else if( _settings->isLegacy() ) 
+        legacy_stages = load_legacy();
+
+    apply_params();
+
+    if( addr < 0 ) saveParams();
+
+    // the custom profile is kept in its own block, as its stages are uploaded one by one
+    if( _settings->open(SETTINGS_PROFILE) < 0 ) 
+        save_custom_profile(legacy_stages);
+
+    load_custom_profile();
+}
+
+int Charger::load_legacy() {
+    int addr = _settings->getLegacyAddr(SETTINGS_CHARGER);
+    int start = addr;
 
     int num_params = 0;
     EEPROM.get(addr, num_params);
 
-    if( num_params != CHARGING_NUMPARAM ) {
-        saveParams();
-        return;
+    if( num_params <= 0 || num_params > CHARGING_NUMPARAM ) {
+        _settings->updateLegacySize( SETTINGS_CHARGER, sizeof(int) + CHARGING_NUMPARAM * sizeof(float) + 
+                                                       sizeof(uint8_t) + CHARGE_MAX_STAGES * sizeof(ChargeStage) );
+        return -1;
     }
 
     addr += sizeof(int);
+    read_params(addr, num_params);
+    addr += num_params * sizeof(float);
 
+    // the older firmware had neither the profile nor the custom stages
+    if( num_params < CHARGING_NUMPARAM ) {
+        _settings->updateLegacySize( SETTINGS_CHARGER, addr - start );
+        return -1;
+    }
+
+    uint8_t profile = CHARGER_DEFAULT_PROFILE;
+    EEPROM.get(addr, profile);
+    _profile = ( profile < CHARGE_NUM_PROFILES ) ? profile : CHARGER_DEFAULT_PROFILE;
+    addr += sizeof(uint8_t);
+
+    _settings->updateLegacySize( SETTINGS_CHARGER, addr - start + CHARGE_MAX_STAGES * sizeof(ChargeStage) );
+    return addr;
+}
+
+void Charger::read_params(int addr, uint8_t num_params) {
     float value;
-    for( int p = 0; p < CHARGING_NUMPARAM; p++ ) {
+    for( uint8_t p = 0; p < num_params; p++ ) {
         value = 0;
         EEPROM.get(addr, value);
         k[p] = value;
         addr += sizeof(float);
     }   
-
-    _settings->updateSize( SETTINGS_CHARGER, addr - _settings->getAddr(SETTINGS_CHARGER) );
 }
 
 void Charger::saveParams() {
-    long addr = _settings->getAddr(SETTINGS_CHARGER);
+    int addr = _settings->create(SETTINGS_CHARGER);
+    int start = addr;
 
-    EEPROM.put( addr, CHARGING_NUMPARAM );
-    addr += sizeof(int);
+    EEPROM.put( addr, _profile );
+    addr += sizeof(uint8_t);
 
     for( int p = 0; p < CHARGING_NUMPARAM; p++ ) {
         EEPROM.put( addr, k[p] );
         addr += sizeof(float);
     }
 
-    _settings->updateSize( SETTINGS_CHARGER, addr - _settings->getAddr(SETTINGS_CHARGER) );
+    _settings->commit( SETTINGS_CHARGER, addr - start );
+}
+
+void Charger::apply_params() {
+    _pid.setTunings( k[CHARGING_KP], k[CHARGING_KI], k[CHARGING_KD] );
+    _pid.setBias( (int16_t) k[CHARGING_TEST] );
+    _pid.setDerivativeMode( k[CHARGING_DERIVATIVE_MODE] ? PID_DERIVATIVE_ON_MEASUREMENT : PID_DERIVATIVE_ON_ERROR );
 }
 
 void Charger::pwmSet10(int value)
 {
-   OCR1B = value;   
-   DDRB |= 1 << 6;  
-   TCCR1A |= 0x20;  
+   hal_pwm_write(value);
 }
\ No newline at end of file
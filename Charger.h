@@ -2,9 +2,13 @@
 #define Charger_h
 
 #include <Print.h>
+#include <util/atomic.h>
 
+#include "HAL.h"
 #include "Settings.h"
 #include "Sensor.h"
+#include "PID.h"
+#include "ChargeProfile.h"
 
 // Maximum charging pulse width = 0.5
 #define MAXCOUT 512
@@ -13,6 +17,15 @@
 
 #define DEFAULT_CHARGER_PWM_OUT     10     // PWM out
 
+#define CHARGER_REGULATE_PERIOD     10     // ticks between the regulation steps
+#define CHARGER_US_PER_TICK         ( 1000000UL / TIMER_ONE_SEC )
+
+// Relay autotuning of the PID
+#define CHARGER_AUTOTUNE_OUTPUT     256                     // PWM output in the "on" state of the relay
+#define CHARGER_AUTOTUNE_HYSTERESIS 0.05F                   // relay hysteresis relative to the target current
+#define CHARGER_AUTOTUNE_CYCLES     4                       // number of oscillation cycles to measure
+#define CHARGER_AUTOTUNE_TIMEOUT    ( 60UL * TIMER_ONE_SEC ) // max duration of the experiment in ticks
+
 
 enum ChargingStatus {
     CHARGING_NOT_STARTED,
@@ -25,7 +38,9 @@ enum ChargingStatus {
     CHARGING_V_SENSOR_NOT_READY,
     CHARGING_TARGET_NOT_SET,
     CHARGING_REPLACE_BATTERY,
-    CHARGING_BATTERY_DEAD
+    CHARGING_BATTERY_DEAD,
+    CHARGING_AUTOTUNE,              // relay autotuning of the PID is in progress
+    CHARGING_AUTOTUNE_FAILED        // autotuning did not converge within the limits
 };
 
 enum ChargerPIDParam {
@@ -33,6 +48,7 @@ enum ChargerPIDParam {
     CHARGING_KI,
     CHARGING_KD,
     CHARGING_TEST,
+    CHARGING_DERIVATIVE_MODE,       // 0 - derivative on error, 1 - derivative on measurement
     CHARGING_NUMPARAM
 };
 
@@ -40,8 +56,12 @@ enum ChargerPIDParam {
  * @brief Charger is the class responsible for managing the battery charging. This class uses the battery 
  *        and current sensor readings to manipulate the PWM output on the pin 10 of Arduino Nano.  
  *        Frequency of the PWM output is defined by Timer 1 registers, which are set in the UPSCore.ino setup() function.
- *        The charging circuit through the battery is defined by the PWM signal. Regulation is done with help of PID regulator
- *        where the battery voltage and current are used as inputs, depending on the phase of the charge (CC, CV or backup).
+ *        The charging circuit through the battery is defined by the PWM signal. Regulation is done with help of 
+ *        the fixed point PID regulator where the battery voltage or current is used as input, depending on the 
+ *        stage of the charge profile (see ChargeProfile.h). Stages are switched by their exit conditions evaluated
+ *        on every regulation step.
+ *        regulate() is expected to be called from the timer interrupt every CHARGER_REGULATE_PERIOD ticks, 
+ *        so the methods called from the loop are modifying the regulator state atomically.
  */
 class Charger {
     public:
@@ -62,7 +82,9 @@ class Charger {
         float get_voltage() { return _charging_voltage; };    
 
         void set_min_battery_voltage(float min_battery_voltage) {_min_battery_voltage = min_battery_voltage; }; 
-        void set_cutoff_current(float cutoff_current) { _cutoff_current = cutoff_current; };
+
+        // battery capacity in AH and number of cells (12V blocks) in series, used for the profile setpoints
+        void set_battery(float capacity, uint8_t num_cells) { _capacity = capacity; _num_cells = num_cells; };
 
         float get_last_deviation() { return _last_deviation; };
         int get_output() { return _cout_regv; };
@@ -72,9 +94,25 @@ class Charger {
         // Increase or decrease cout_regv depending on the sensor reading
         // Current and voltage sensors must be set before calling
         // @param ticks current time in ticks 
-        void regulate( unsigned long ticks );                                   
+        // @param latency delay of the call from the start of the tick in microseconds, used for the jitter measurement
+        void regulate( unsigned long ticks, uint16_t latency = 0 );                                   
+
+        // max deviation of the period between regulate() calls from CHARGER_REGULATE_PERIOD, in microseconds
+        uint16_t get_jitter() { return _jitter; };
+        void reset_jitter() { _jitter = 0; _last_call_us = 0; };
+
+        // housekeeping which cannot be done from the timer interrupt (to be called in the loop)
+        void service();
                                                              
-        void start(float charging_current, float charging_voltage, unsigned long ticks);
+        // Start charging from the first stage of the selected profile
+        void start(unsigned long ticks);
+
+        // Start the relay autotuning of the PID. The PWM output is switched between 0 and CHARGER_AUTOTUNE_OUTPUT
+        // around the charging current till CHARGER_AUTOTUNE_CYCLES oscillations are measured. Then the PID 
+        // params are computed from the period and amplitude of the oscillations, applied and saved in EEPROM, 
+        // and the charging continues as normal. The experiment is aborted if the battery voltage reaches the 
+        // charging voltage or the time is out, and fails if the computed gains exceed the limits of the PID.
+        void autotune(float charging_current, float charging_voltage, unsigned long ticks);
 
         void stop();
 
@@ -84,7 +122,25 @@ class Charger {
 
         void set_mode( uint16_t charging_mode ) { _charging_mode = charging_mode; };
 
-        void setParam(float value, ChargerPIDParam param) { k[param] = value; };
+        // select the charge profile (ChargeProfileId). If charging, the profile is started over
+        void set_profile( uint8_t profile );
+        uint8_t get_profile() { return _profile; };
+
+        // stage of the profile being executed
+        uint8_t get_stage() { return _stage; };
+
+        // read a stage of the profile from PROGMEM or the RAM copy of the custom profile
+        void read_stage(uint8_t profile, uint8_t stage, ChargeStage* data);
+
+        // set a field (ChargeStageField) of the custom profile stage in EEPROM
+        void set_custom_stage(uint8_t stage, uint8_t field, int16_t value);
+
+        // print the stages of the selected profile
+        void print_profile(Print* stream);
+
+        void setParam(float value, ChargerPIDParam param) { 
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { k[param] = value; apply_params(); } 
+        };
         float getParam(ChargerPIDParam param) { return k[param]; };
 
         void loadParams();
@@ -102,16 +158,26 @@ class Charger {
         // charging voltage value (to be compared with sensor)
         float _charging_voltage;   
 
-        // Integrated error
-        float _deviation_sum;  
+        // PID regulator of the PWM output
+        PID _pid;
 
-        // Last deviation for calculating derivative
+        // Last relative deviation from the target
         float _last_deviation;     
 
         // the ticks on the latest regulate() or start() call
         unsigned long _last_ticks;  
         int _elapsed_ticks;   
 
+        // time of the latest regulate() call in microseconds and max deviation of the period
+        unsigned long _last_call_us = 0;
+        uint16_t _jitter = 0;
+
+        // ticks of the latest regulate() call, the start of the stage switched from the loop
+        unsigned long _regulate_ticks = 0;
+
+        // params were changed in the interrupt and have to be saved to EEPROM
+        volatile bool _save_pending = false;
+
         // PID params
         float k[CHARGING_NUMPARAM];   
           
@@ -122,7 +188,44 @@ class Charger {
 
         float _min_battery_voltage;
 
-        float _cutoff_current;
+        // battery capacity and number of cells
+        float _capacity;
+        uint8_t _num_cells;
+
+        // charge profile state
+        uint8_t _profile;
+        uint8_t _stage;
+        ChargeStage _stage_data;
+
+        // copy of the custom profile kept in EEPROM, so the stages are loaded in the interrupt
+        ChargeStage _custom_profile[CHARGE_MAX_STAGES];
+        unsigned long _stage_start;
+
+        // stage exit thresholds converted to Amps and Volts
+        float _exit_current;
+        float _exit_voltage;
+
+        // reference point of the dV/dt exit condition
+        float _dvdt_voltage;
+        unsigned long _dvdt_ticks;
+
+        // check the exit conditions of the stage and return the next stage or CHARGE_STAGE_NONE
+        uint8_t evaluate_stage(float reading_c, float reading_v, unsigned long ticks);
+
+        // switch to the stage, the regulation continues with its target without a bump
+        void enter_stage(uint8_t stage, unsigned long ticks);
+
+        // read the custom profile from EEPROM to the RAM copy
+        void load_custom_profile();
+
+        // write the custom profile copying the stages at from, or the default profile if from is -1. 
+        // The stage is replaced by data
+        void save_custom_profile(int from, uint8_t stage = CHARGE_MAX_STAGES, const ChargeStage* data = nullptr);
+
+        // migrate the params saved by the older firmware, returns the address of the old custom stages or -1
+        int load_legacy();
+
+        void read_params(int addr, uint8_t num_params);
 
         Sensor* _current_sensor = NULL;
         Sensor* _voltage_sensor = NULL;
@@ -131,11 +234,30 @@ class Charger {
 
         void set_charging(bool charging) {
             _charging = charging;
-            _deviation_sum = _last_deviation = 0;
+            _last_deviation = 0;
             _cout_regv = 0;
+            _pid.reset();
             pwmSet10(0);  
         };
 
+        // push the PID params to the regulator
+        void apply_params();
+
+        // relay autotuning state
+        unsigned long _tune_start;
+        unsigned long _tune_last_switch;
+        bool _tune_high;
+        uint8_t _tune_switches;
+        uint8_t _tune_cycles;
+        float _tune_max, _tune_min;
+        float _tune_period_sum, _tune_amplitude_sum;
+
+        // one step of the relay experiment
+        void autotune_step(float reading_c, float reading_v, unsigned long ticks);
+
+        // compute and apply PID params from the measured oscillations
+        void autotune_finish(unsigned long ticks);
+
         // analogWrite replacement for FastPWM 10-bit mode on pin 10
         void pwmSet10(int value);
 
@@ -0,0 +1,69 @@
+#ifndef CommandTable_h
+#define CommandTable_h
+
+#include <Arduino.h>
+
+#define COMMAND_KEY_SIZE        3       // max number of letters in the command key
+#define COMMAND_PATTERN_SIZE    8       // max length of the argument pattern
+#define COMMAND_MAX_ARGS        4       // max number of the arguments parsed from a command
+#define COMMAND_MAX_FIELD       17      // max number of symbols in an argument
+
+// Argument grammar. The pattern is a sequence of literal symbols to match and argument fields,
+// each field is parsed as a number into the next argument. Fields are concatenated with the literals,
+// e.g. "P" ARG_DIGIT "V" ARG_FLOAT
+#define ARG_DIGIT       "d"     // 1 symbol number
+#define ARG_MINUTES     "m"     // 2 symbol number, minutes (may be fractional, like .2)
+#define ARG_RESTORE     "r"     // 4 symbol number
+#define ARG_FLOAT       "f"     // float value up to 17 symbols
+#define ARG_OPTIONAL    "["     // the rest of the pattern is optional
+
+class Voltronic;
+
+// handler of a command. Gets the result from the table and returns the ExecuteCommand to be processed
+// by the main loop
+typedef int (*CommandHandler)(Voltronic* protocol, int result);
+
+/**
+ * @brief CommandEntry is a row of the command table. The key is the leading letters of the command,
+ *        the table is searched by the longest key matching the input. Entries with the same key are
+ *        tried in the table order till the pattern matches, so the more specific patterns go first.
+ *        The result is returned as is if there is no handler.
+ */
+struct CommandEntry {
+    char key[COMMAND_KEY_SIZE + 1];
+    char pattern[COMMAND_PATTERN_SIZE];
+    CommandHandler handler;
+    uint8_t result;
+};
+
+/**
+ * @brief CommandDialect is a set of commands of a protocol. The table is kept in PROGMEM, sorted by the key.
+ *        The protocol symbol is reported by the M command.
+ */
+struct CommandDialect {
+    char protocol;
+    const CommandEntry* table;
+    uint8_t size;
+};
+
+// compile time check of the table order, used as static_assert( command_table_sorted(TABLE), ... )
+constexpr int command_key_cmp(const char* a, const char* b) {
+    return ( *a != *b || !*a ) ? ( (unsigned char) *a - (unsigned char) *b ) : command_key_cmp(a + 1, b + 1);
+}
+
+constexpr bool command_table_sorted(const CommandEntry* table, uint8_t size) {
+    return size < 2 || ( command_key_cmp(table[0].key, table[1].key) <= 0 && command_table_sorted(table + 1, size - 1) );
+}
+
+// number of symbols of the argument field, 0 if the symbol is a literal
+inline uint8_t command_field_len(char symbol) {
+    switch(symbol) {
+        case 'd': return 1;
+        case 'm': return 2;
+        case 'r': return 4;
+        case 'f': return COMMAND_MAX_FIELD;
+        default:  return 0;
+    }
+}
+
+#endif
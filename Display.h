@@ -7,6 +7,20 @@
 #include "Charger.h"
 #include "Sensor.h"
 
+// DISPLAY_FLUSH_BYTES are sent to the display per loop pass, so the loop is not blocked by the slow display bus
+#ifdef DISPLAY_TYPE_LCD_HD44780
+const int DISPLAY_BLINK_FREQ            = TIMER_ONE_SEC;
+const uint8_t DISPLAY_FLUSH_BYTES       = 2;        // each byte is 6 I2C transactions through the expander
+#else
+const int DISPLAY_BLINK_FREQ            = TIMER_ONE_SEC * 0.5;
+const uint8_t DISPLAY_FLUSH_BYTES       = 4;        // 2 bytes per grid
+#endif
+
+// the frame is redrawn on the change of the displayed values, and at least every 10 sec
+const uint8_t DISPLAY_HEARTBEAT_PERIODS = 10 * TIMER_ONE_SEC / DISPLAY_BLINK_FREQ;
+
+#define DISPLAY_MAX_FIELDS      12      // values compared by update()
+
 enum DisplayToggleMode {
     DISPLAY_TOGGLE,
     DISPLAY_ON,
@@ -46,19 +60,54 @@ class AbstractDisplay {
         void set_brightness(int brightness) { _brightness = brightness; setup_display(); }
 
         virtual void toggle_display_mode(){;};
-        virtual void set_display_mode(uint8_t mode){;};
+        virtual void set_display_mode(uint8_t){;};
         virtual uint8_t get_display_mode(){ return 0;};
 
-        void init_refresh(){ _refresh = true;};
+        void init_refresh(){ _refresh = true; _heartbeat = 0; };
+
+        // call from the timer every DISPLAY_BLINK_FREQ. The frame is redrawn if it is blinking or by the heartbeat
+        void heartbeat() {
+            if( on_heartbeat() || ++_heartbeat >= DISPLAY_HEARTBEAT_PERIODS ) init_refresh();
+        };
+
+        // call once the readings are computed, the frame is redrawn if a displayed value has changed
+        void update() {
+            if( _active && on_update() ) init_refresh();
+        };
+        // call every loop pass. The frame is rendered on request and then sent by DISPLAY_FLUSH_BYTES per call
         void refresh() {
-            if(!_active || !_refresh) return;
-            on_refresh();
-            _refresh = false;
+            if(!_active) return;
+
+            // the next frame is rendered once the previous one is sent
+            if( _refresh && !_flushing ) {
+                on_refresh();
+                _refresh = false;
+                _flushing = true;
+            }
+
+            if( _flushing ) _flushing = !on_flush(DISPLAY_FLUSH_BYTES);
         };
 
     protected:
+        // render the frame to be sent
         virtual void on_refresh(){;};
 
+        // returns true if the values shown by the frame are changed, see update_fields()
+        virtual bool on_update(){ return true; };
+
+        // toggle the blink, returns true if the frame has blinking segments
+        virtual bool on_heartbeat(){ return false; };
+
+        // keep the values rounded to the display resolution, returns true if any differs from the kept one
+        bool update_fields(const int16_t* values, uint8_t size) {
+            if( !memcmp(_fields, values, size * sizeof(int16_t)) ) return false;
+            memcpy(_fields, values, size * sizeof(int16_t));
+            return true;
+        };
+
+        // send the next bytes of the frame within the budget, returns true once the frame is complete
+        virtual bool on_flush(uint8_t){ return true; };
+
         virtual void setup_display(){;};
 
         Interactive *_lineups;
@@ -68,18 +117,20 @@ class AbstractDisplay {
 
         bool _active;
         bool _refresh;
+        bool _flushing = false;
+        volatile uint8_t _heartbeat = 0;
+
+        int16_t _fields[DISPLAY_MAX_FIELDS];
 
         int _brightness;
 
 };
 
 #ifdef DISPLAY_TYPE_LED_TM1640
-const int DISPLAY_BLINK_FREQ      = TIMER_ONE_SEC * 0.5;
 #include "LED_TM1640.h"
 #endif
 
 #ifdef DISPLAY_TYPE_LCD_HD44780
-const int DISPLAY_BLINK_FREQ      = TIMER_ONE_SEC;
 #include "LCD_HD44780.h"
 #endif 
 
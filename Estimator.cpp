@@ -0,0 +1,146 @@
+#include "Estimator.h"
+
+
+RuntimeEstimator::RuntimeEstimator(Settings* settings, unsigned long window) {
+    _settings = settings;
+    _window = window;
+
+    k[ESTIMATOR_PEUKERT] = INTERACTIVE_BATTERY_PEUKERT;
+}
+
+void RuntimeEstimator::update(float current, float level, unsigned long ticks) {
+
+    unsigned long elapsed = ticks - _last_ticks;
+    if( elapsed < _window ) return;
+    _last_ticks = ticks;
+
+    float discharge = -current;
+
+    if( !_discharging && discharge > ESTIMATOR_EVENT_CURRENT ) {
+        // discharge event started, seed the average with the actual load
+        _discharging = true;
+        _start_level = level;
+        _start_ticks = ticks;
+        _discharged_ah = 0.0F;
+        _load_current = discharge;
+        _idle_windows = 0;
+    }
+    else if( _discharging ) {
+        if( discharge > ESTIMATOR_MIN_CURRENT ) {
+            _idle_windows = 0;
+            _discharged_ah += discharge * elapsed / ESTIMATOR_TICKS_PER_HOUR;
+            _load_current += ESTIMATOR_LOAD_SMOOTHING * ( discharge - _load_current );
+        }
+        else {
+            // the event ends at the first idle window, unless the discharge resumes. The average is kept
+            if( !_idle_windows++ ) {
+                _end_level = level;
+                _end_ticks = ticks;
+            }
+
+            // over after the idle windows in a row or at once on charging, fitted before the charger raises the level
+            if( _idle_windows >= ESTIMATOR_END_WINDOWS || current > ESTIMATOR_EVENT_CURRENT ) {
+                _discharging = false;
+                _load_current = 0.0F;
+                _events++;
+                fit(_end_level, _end_ticks);
+            }
+        }
+    }
+
+    if( _discharging )
+        _remaining_min = runtime(level, _load_current);
+    else
+        _remaining_min = ( current > ESTIMATOR_MIN_CURRENT ) ? -1.0F : ESTIMATOR_MAX_MINUTES;
+}
+
+float RuntimeEstimator::capacity() {
+    float derating = 1.0F + INTERACTIVE_BATTERY_TEMP_COEFF * ( _temperature - ESTIMATOR_DEFAULT_TEMP );
+    return INTERACTIVE_TOTAL_BATTERY_CAP * constrain(derating, 0.5F, 1.2F);
+}
+
+float RuntimeEstimator::runtime(float level, float current) {
+    if( current <= 0.0F ) return ESTIMATOR_MAX_MINUTES;
+
+    // Peukert's law: time to full discharge at the given current, in hours
+    float hours = INTERACTIVE_BATTERY_RATED_HOURS *
+                  pow( capacity() / ( current * INTERACTIVE_BATTERY_RATED_HOURS ), k[ESTIMATOR_PEUKERT] );
+
+    return min( level * hours * 60.0F, ESTIMATOR_MAX_MINUTES );
+}
+
+void RuntimeEstimator::fit(float level, unsigned long ticks) {
+    float drop = _start_level - level;
+    float hours = (float)( ticks - _start_ticks ) / ESTIMATOR_TICKS_PER_HOUR;
+
+    if( drop < ESTIMATOR_FIT_MIN_DROP || hours <= 0.0F || _discharged_ah <= 0.0F ) return;
+
+    // capacity delivered at the average load vs the rated one:
+    // C_eff = C * ( C / ( I * H ) ) ^ ( k - 1 )
+    float c = capacity();
+    float observed = _discharged_ah / drop;
+    float load_ratio = log( c / ( _discharged_ah / hours * INTERACTIVE_BATTERY_RATED_HOURS ) );
+
+    // the load was too close to the rated one to tell the exponent
+    if( abs(load_ratio) < 0.1F ) return;
+
+    float fitted = 1.0F + log( observed / c ) / load_ratio;
+    fitted = constrain( fitted, ESTIMATOR_MIN_PEUKERT, ESTIMATOR_MAX_PEUKERT );
+
+    k[ESTIMATOR_PEUKERT] += ESTIMATOR_FIT_WEIGHT * ( fitted - k[ESTIMATOR_PEUKERT] );
+
+    saveParams();
+}
+
+static_assert( ESTIMATOR_NUMPARAM * sizeof(float) <= SETTINGS_BLOCK_SIZE[SETTINGS_ESTIMATOR], "Estimator params do not fit the settings block" );
+
+void RuntimeEstimator::loadParams() {
+    int addr = _settings->open(SETTINGS_ESTIMATOR);
+
+    if( addr >= 0 ) {
+        // params saved by an older firmware are loaded, the new ones keep defaults
+        uint8_t num_params = min( _settings->getSize(SETTINGS_ESTIMATOR) / sizeof(float), (size_t) ESTIMATOR_NUMPARAM );
+        read_params(addr, num_params);
+    }
+    else if( _settings->isLegacy() ) 
+        load_legacy();
+
+    // discard the values out of the model limits
+    if( !( k[ESTIMATOR_PEUKERT] >= ESTIMATOR_MIN_PEUKERT && k[ESTIMATOR_PEUKERT] <= ESTIMATOR_MAX_PEUKERT ) )
+        k[ESTIMATOR_PEUKERT] = INTERACTIVE_BATTERY_PEUKERT;
+
+    if( addr < 0 ) saveParams();
+}
+
+void RuntimeEstimator::load_legacy() {
+    int addr = _settings->getLegacyAddr(SETTINGS_ESTIMATOR);
+
+    int num_params = 0;
+    EEPROM.get(addr, num_params);
+
+    _settings->updateLegacySize( SETTINGS_ESTIMATOR, sizeof(int) + ESTIMATOR_NUMPARAM * sizeof(float) );
+
+    if( num_params == ESTIMATOR_NUMPARAM ) read_params(addr + sizeof(int), ESTIMATOR_NUMPARAM);
+}
+
+void RuntimeEstimator::read_params(int addr, uint8_t num_params) {
+    float value;
+    for( uint8_t p = 0; p < num_params; p++ ) {
+        value = 0;
+        EEPROM.get(addr, value);
+        k[p] = value;
+        addr += sizeof(float);
+    }
+}
+
+void RuntimeEstimator::saveParams() {
+    int addr = _settings->create(SETTINGS_ESTIMATOR);
+    int start = addr;
+
+    for( int p = 0; p < ESTIMATOR_NUMPARAM; p++ ) {
+        EEPROM.put( addr, k[p] );
+        addr += sizeof(float);
+    }
+
+    _settings->commit( SETTINGS_ESTIMATOR, addr - start );
+}
@@ -0,0 +1,116 @@
+#ifndef Estimator_h
+#define Estimator_h
+
+#include "config.h"
+#include "Settings.h"
+
+// battery current below this level (Amps) is treated as idle
+const float ESTIMATOR_MIN_CURRENT = 0.05F;
+// discharge above this level (Amps) starts the event, charging above it ends the event at once.
+// About 3 steps of the battery current ADC, so the event is not started or ended by the noise
+const float ESTIMATOR_EVENT_CURRENT = 0.2F;
+// idle windows in a row ending the discharge event
+const uint8_t ESTIMATOR_END_WINDOWS = 10;
+// smoothing factor of the exponential average of the load current, applied once per window
+const float ESTIMATOR_LOAD_SMOOTHING = 0.1F;
+// max value reported for the remaining time in minutes
+const float ESTIMATOR_MAX_MINUTES = 999.0F;
+// limits of the Peukert exponent accepted from the fitting
+const float ESTIMATOR_MIN_PEUKERT = 1.0F;
+const float ESTIMATOR_MAX_PEUKERT = 1.6F;
+// minimum drop of the battery level during a discharge event to be used for the fitting
+const float ESTIMATOR_FIT_MIN_DROP = 0.2F;
+// weight of a new fitting result against the current Peukert exponent
+const float ESTIMATOR_FIT_WEIGHT = 0.3F;
+// temperature the battery capacity is rated at
+const float ESTIMATOR_DEFAULT_TEMP = 25.0F;
+// ticks per hour, used for integrating the discharged capacity
+const float ESTIMATOR_TICKS_PER_HOUR = 3600.0F * TIMER_ONE_SEC;
+
+enum EstimatorParam {
+    ESTIMATOR_PEUKERT,
+    ESTIMATOR_NUMPARAM
+};
+
+/**
+ * @brief RuntimeEstimator calculates the remaining time on battery using the Peukert's law:
+ *        t = H * ( C / ( I * H ) ) ^ k, where C is the battery capacity rated for H hours of discharge,
+ *        I is the discharge current and k is the Peukert exponent. The load current is smoothed by
+ *        exponential average and the capacity is derated by the temperature.
+ *        The estimate is recalculated once per sensor window and cached until the next one.
+ *        The Peukert exponent is fitted automatically from the observed discharge events and saved in EEPROM.
+ */
+class RuntimeEstimator {
+    public:
+        RuntimeEstimator(Settings * settings, unsigned long window = TIMER_ONE_SEC);
+
+        // recalculate the estimate if the sensor window has elapsed since the last update
+        // @param current battery current, negative on discharge
+        // @param level normalized battery charge level (0.0 - empty, 1.0 - fully charged)
+        // @param ticks current time in ticks
+        void update(float current, float level, unsigned long ticks);
+
+        // cached remaining time on battery in minutes, -1 when charging
+        float get_remaining_minutes() { return _remaining_min; };
+
+        float get_load_current() { return _load_current; };
+
+        bool is_discharging() { return _discharging; };
+
+        // number of the discharge events finished since the power-on
+        uint16_t get_events() { return _events; };
+
+        // battery temperature in C, used for capacity derating
+        void set_temperature(float temperature) { _temperature = temperature; };
+
+        void setParam(float value, EstimatorParam param) { k[param] = value; };
+        float getParam(EstimatorParam param) { return k[param]; };
+
+        void loadParams();
+
+        void saveParams();
+
+    private:
+        Settings * _settings;
+
+        // model params
+        float k[ESTIMATOR_NUMPARAM];
+
+        // migrate the params saved by the older firmware
+        void load_legacy();
+
+        void read_params(int addr, uint8_t num_params);
+
+        unsigned long _window;
+        unsigned long _last_ticks = 0;
+
+        float _temperature = ESTIMATOR_DEFAULT_TEMP;
+
+        // smoothed discharge current, Amps
+        float _load_current = 0.0F;
+
+        float _remaining_min = 0.0F;
+
+        // discharge event tracking
+        bool _discharging = false;
+        float _start_level;
+        float _discharged_ah;
+        unsigned long _start_ticks;
+        uint16_t _events = 0;
+
+        // idle windows in a row, the level and the time of the first one
+        uint8_t _idle_windows;
+        float _end_level;
+        unsigned long _end_ticks;
+
+        // battery capacity in AH, derated by the temperature
+        float capacity();
+
+        // remaining time in minutes for a given level and discharge current
+        float runtime(float level, float current);
+
+        // fit the Peukert exponent from the discharge event finished at the given level and time
+        void fit(float level, unsigned long ticks);
+};
+
+#endif
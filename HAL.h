@@ -0,0 +1,54 @@
+#ifndef HAL_h
+#define HAL_h
+
+#include <Arduino.h>
+
+#include "config.h"
+
+// The hardware used by the firmware beyond the Arduino core: the 1ms tick timer, the charger PWM, the USART and
+// the power down sleep. On AVR the functions are inline in HAL_AVR.h, as the USART ones are called from the
+// interrupts. The host build links extras/host/HAL_Linux.cpp, which simulates them on Linux.
+// The interrupt handlers stay in the modules, defined by the ISR() macro.
+
+#ifdef __AVR__
+
+#include "HAL_AVR.h"
+
+#else
+
+// Timer 0 interrupt TIMER0_COMPA_vect every 1ms, Timer 1 in the 10-bit fast PWM mode, faster ADC clock
+extern void hal_begin_timers();
+
+// microseconds since the start of the current 1ms tick
+extern uint16_t hal_tick_latency();
+
+// duty of the 10-bit PWM on the charger output, 0-1023
+extern void hal_pwm_write(uint16_t value);
+
+// 8N1, the received bytes are passed to USART_RX_vect
+extern void hal_uart_begin(unsigned long baud);
+
+// enable the USART_UDRE_vect interrupt and clear the transmit complete flag
+extern void hal_uart_start_tx();
+
+// disable the USART_UDRE_vect interrupt
+extern void hal_uart_stop_tx();
+
+// the data register can take the next byte
+extern bool hal_uart_tx_ready();
+
+// all the bytes written are sent
+extern bool hal_uart_tx_complete();
+
+extern uint8_t hal_uart_read();
+extern void hal_uart_write(uint8_t ch);
+
+extern bool hal_interrupts_enabled();
+
+// power down for the timeout periods of 250ms, the ADC and the tick timer are stopped.
+// The watchdog is restarted with the 2 sec timeout
+extern void hal_sleep(uint32_t timeout);
+
+#endif
+
+#endif
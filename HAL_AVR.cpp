@@ -0,0 +1,77 @@
+#ifdef __AVR__
+
+#include "HAL.h"
+
+#include <avr/sleep.h>
+
+#define SLEEP_MODE SLEEP_MODE_PWR_DOWN
+
+void hal_begin_timers() {
+    cli(); // stop interrupts
+
+    // Timer 0 1000Hz. Used for display refresh, blinker and sensor readings.
+    TCNT0 = 0;
+    TCCR0A = _BV(WGM00)|_BV(WGM01);            /* Fast PWM, pins not activated */
+    TCCR0B = _BV(WGM02)|_BV(CS01)|_BV(CS00);   /* Fast PWM, Prescaler = x64     */
+    OCR0A = 249;
+    TIMSK0 = _BV(OCIE0A);
+
+    // Timer 1 used for charging (15.6KHz)
+    TCCR1A = _BV(WGM10) | _BV(WGM11);  // 10bit
+    TCCR1B = _BV(WGM12) | _BV(CS10);   // x1 fast pwm
+
+    // accelerate analogRead
+    ADCSRA |= _BV(ADPS2); 
+    ADCSRA &= ~_BV(ADPS1);
+    ADCSRA &= ~_BV(ADPS0);
+
+    sei(); // resume interrupts
+}
+
+void hal_uart_begin(unsigned long baud) {
+    uint16_t ubrr = (uint16_t)( ( F_CPU / 4 / baud - 1 ) / 2 );
+
+    UCSR0A = _BV(U2X0);
+    UBRR0H = highByte(ubrr);
+    UBRR0L = lowByte(ubrr);
+
+    // 8N1, RX interrupt on. UDRE interrupt is enabled when there is something to send
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+    UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+}
+
+void hal_sleep(uint32_t timeout) {
+
+    wdt_disable();
+
+    ADCSRA &= ~ (1 << ADEN);    // Disable ADC
+    ACSR |= (1 << ACD);         // Disable comparator
+
+    while (timeout > 0) {
+
+        wdt_enable(WDTO_250MS);                   // Enable WDT
+        WDTCSR |= (1 << WDIE);                    // Режим ISR+RST
+
+        wdt_reset();                            // Reset WDT  
+        set_sleep_mode(SLEEP_MODE);   
+        sleep_enable(); 				        // Enable sleep mode
+        sleep_cpu(); 				            // Put the CPU to sleep
+        sleep_disable();                        // Disable sleep mode
+        wdt_disable();                          // Disable WDT
+        wdt_reset();                            // Reset WDT
+
+        timeout --;
+    }
+    
+    ADCSRA |= (1 << ADEN);      // Enable ADC
+    ACSR &= ~ (1 << ACD);       // Enable comparator
+    
+    wdt_enable(WDTO_2S);
+
+}
+
+ISR(WDT_vect) {                     
+    for(int i=0; i<1000;i++);
+}
+
+#endif
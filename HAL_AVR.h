@@ -0,0 +1,43 @@
+#ifndef HAL_AVR_h
+#define HAL_AVR_h
+
+// ATmega328P implementation of the HAL, see HAL.h
+
+#include <Arduino.h>
+#include <avr/wdt.h>
+
+extern void hal_begin_timers();
+
+inline uint16_t hal_tick_latency() { 
+    // Timer 0 is counting at 250kHz, 4us per count since the start of the tick
+    return (uint16_t) TCNT0 * 4; 
+}
+
+// FastPWM 10-bit mode on pin 10
+inline void hal_pwm_write(uint16_t value) {
+    OCR1B = value;   
+    DDRB |= 1 << 6;  
+    TCCR1A |= 0x20;  
+}
+
+extern void hal_uart_begin(unsigned long baud);
+
+// TXC is cleared by writing 1
+inline void hal_uart_start_tx() {
+    UCSR0A = ( UCSR0A & _BV(U2X0) ) | _BV(TXC0);
+    UCSR0B |= _BV(UDRIE0);
+}
+
+inline void hal_uart_stop_tx() { UCSR0B &= ~_BV(UDRIE0); }
+
+inline bool hal_uart_tx_ready() { return bit_is_set(UCSR0A, UDRE0); }
+inline bool hal_uart_tx_complete() { return bit_is_set(UCSR0A, TXC0); }
+
+inline uint8_t hal_uart_read() { return UDR0; }
+inline void hal_uart_write(uint8_t ch) { UDR0 = ch; }
+
+inline bool hal_interrupts_enabled() { return bit_is_set(SREG, SREG_I); }
+
+extern void hal_sleep(uint32_t timeout);
+
+#endif
@@ -166,36 +166,5 @@ void Interactive::writeStatus(uint16_t nbit, bool value) {
 }
 
 void Interactive::sleep(uint32_t timeout) {
-
-    wdt_disable();
-
-
-    ADCSRA &= ~ (1 << ADEN);    // Disable ADC
-    ACSR |= (1 << ACD);         // Disable comparator
-
-    while (timeout > 0) {
-
-        wdt_enable(WDTO_250MS);                   // Enable WDT
-        WDTCSR |= (1 << WDIE);                    // Режим ISR+RST
-
-        wdt_reset();                            // Reset WDT  
-        set_sleep_mode(SLEEP_MODE);   
-        sleep_enable(); 				        // Enable sleep mode
-        sleep_cpu(); 				            // Put the CPU to sleep
-        sleep_disable();                        // Disable sleep mode
-        wdt_disable();                          // Disable WDT
-        wdt_reset();                            // Reset WDT
-
-        timeout --;
-    }
-    
-    ADCSRA |= (1 << ADEN);      // Enable ADC
-    ACSR &= ~ (1 << ACD);       // Enable comparator
-    
-    wdt_enable(WDTO_2S);
-
-}
-
-ISR(WDT_vect) {                     
-    for(int i=0; i<1000;i++);
+    hal_sleep(timeout);
 }
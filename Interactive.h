@@ -2,8 +2,7 @@
 #define Interactive_h
 
 #include "config.h"
-#include "avr/wdt.h"
-#include "avr/sleep.h"
+#include "HAL.h"
 
 #include "SimpleTimer.h"
 #include "Sensor.h"
@@ -11,7 +10,6 @@
 
  // Configure sleep mode
 #define DEFAULT_SLEEP_TIMEOUT 4 
-#define SLEEP_MODE SLEEP_MODE_PWR_DOWN
 
 // number of ticks for inverter to set the output voltage within limits
 const int INVERTER_GRACE_PERIOD = 200;
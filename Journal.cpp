@@ -0,0 +1,154 @@
+#include "Journal.h"
+
+static_assert( JOURNAL_NUMRECORDS >= 8, "Journal does not fit the EEPROM" );
+static_assert( JOURNAL_QUEUE_SIZE >= 2, "Journal merges into the update not being written" );
+
+void Journal::begin() {
+    _head = 0;
+    _count = 0;
+
+    JournalRecord record, next;
+    for( uint8_t slot = 0; slot < JOURNAL_NUMRECORDS; slot++ ) {
+        if( !read_slot(slot, &record) ) continue;
+        _count++;
+
+        // the latest record is not followed by the next in the sequence
+        uint8_t next_slot = ( slot + 1 ) % JOURNAL_NUMRECORDS;
+        if( read_slot(next_slot, &next) && next.seq == (uint8_t)( record.seq + 1 ) ) continue;
+
+        _head = next_slot;
+        _seq = record.seq + 1;
+        _boot = record.boot + 1;
+    }
+}
+
+void Journal::update(uint16_t status, unsigned long ticks, float input_vac, float battery_level) {
+    uint32_t uptime = ticks / TIMER_ONE_SEC;
+
+    // the bits set while the readings settle are not the transitions, the settled status is the reference
+    if( !_booted ) {
+        if( ticks < JOURNAL_SETTLE_TIME ) return;
+
+        _booted = true;
+        _status = status;
+        _last_change = uptime;
+        log(0, status, uptime, input_vac, battery_level);
+        return;
+    }
+
+    uint16_t changed = ( status ^ _status ) & JOURNAL_EVENT_MASK;
+    if( !changed ) return;
+
+    log(changed, status, uptime, input_vac, battery_level);
+
+    _status = status;
+    _last_change = uptime;
+}
+
+void Journal::log(uint16_t events, uint16_t status, uint32_t uptime, float input_vac, float battery_level) {
+    // the full queue takes the transitions into its latest update. A bit flapping back before being written
+    // cancels its pending transition, as the state written last stays valid
+    if( _queued == JOURNAL_QUEUE_SIZE ) {
+        JournalEntry* tail = &_queue[( _queue_head + _queued - 1 ) % JOURNAL_QUEUE_SIZE];
+
+        for( uint16_t flapped = tail->events & events; flapped; flapped &= flapped - 1 ) 
+            _dropped = min( _dropped + 2, UINT8_MAX );
+
+        tail->events ^= events;
+        tail->status = status;
+        if( !tail->events ) _queued--;
+        return;
+    }
+
+    JournalEntry* entry = &_queue[( _queue_head + _queued ) % JOURNAL_QUEUE_SIZE];
+    JournalRecord* record = &entry->record;
+
+    record->event = JOURNAL_EVENT_BOOT | JOURNAL_EVENT_SET;
+    record->boot = _boot;
+    record->uptime = uptime;
+    record->input_vac = (uint16_t) round( input_vac * 10 );
+    record->battery_level = (uint8_t) round( battery_level * 100 );
+    record->duration = (uint16_t) min( uptime - _last_change, (uint32_t) UINT16_MAX );
+
+    entry->events = events;
+    entry->status = status;
+
+    _queued++;
+}
+
+void Journal::seal(JournalEntry* entry) {
+    JournalRecord* record = &entry->record;
+
+    // the lowest bit not written yet
+    if( entry->events ) {
+        uint8_t bit = 0;
+        while( !bitRead(entry->events, bit) ) bit++;
+        record->event = bit | ( bitRead(entry->status, bit) ? JOURNAL_EVENT_SET : 0 );
+    }
+
+    record->seq = _seq++;
+    record->crc = crc(record);
+}
+
+void Journal::service() {
+    if( !_queued || !eeprom_is_ready() ) return;
+
+    JournalEntry* entry = &_queue[_queue_head];
+    if( !_write_pos ) seal(entry);
+
+    // the byte is written by the EEPROM in the background, the next one waits for the next pass
+    const uint8_t* data = (const uint8_t*) &entry->record;
+    EEPROM.update( JOURNAL_BASE + _head * sizeof(JournalRecord) + _write_pos, data[_write_pos] );
+
+    if( ++_write_pos < sizeof(JournalRecord) ) return;
+
+    _write_pos = 0;
+    _head = ( _head + 1 ) % JOURNAL_NUMRECORDS;
+    if( _count < JOURNAL_NUMRECORDS ) _count++;
+
+    // the next bit of the same update is written from the same readings
+    entry->events &= entry->events - 1;
+    if( entry->events ) return;
+
+    _queue_head = ( _queue_head + 1 ) % JOURNAL_QUEUE_SIZE;
+    _queued--;
+}
+
+bool Journal::read(uint8_t n, JournalRecord* record) {
+    if( n >= _count ) return false;
+    return read_slot( ( _head + JOURNAL_NUMRECORDS - 1 - n ) % JOURNAL_NUMRECORDS, record );
+}
+
+void Journal::print(Print* stream, uint8_t page) {
+    ex_format(stream, '#', ex_int<2>(_count), ' ', ex_int<3>(_dropped), "\r\n");
+
+    uint16_t n = page * JOURNAL_PAGE_SIZE;
+    if( n >= _count ) return;
+
+    JournalRecord record;
+    for( uint8_t i = n; i < n + JOURNAL_PAGE_SIZE && read(i, &record); i++ ) {
+        ex_format(stream, '(',
+            ex_int<2>(i), ' ',
+            ex_int<5>(record.boot), ' ',
+            ex_int<7>(record.uptime), ' ',
+            ex_int<2>(record.event & ~JOURNAL_EVENT_SET), ' ',
+            ( record.event & JOURNAL_EVENT_SET ) ? '1' : '0', ' ',
+            ex_fixed<4,1>(record.input_vac / 10.0F), ' ',
+            ex_int<3>(record.battery_level), ' ',
+            ex_int<5>(record.duration), "\r\n"
+        );
+    }
+}
+
+bool Journal::read_slot(uint8_t slot, JournalRecord* record) {
+    EEPROM.get( JOURNAL_BASE + slot * sizeof(JournalRecord), *record );
+    return record->crc == crc(record);
+}
+
+uint8_t Journal::crc(const JournalRecord* record) {
+    uint8_t crc = JOURNAL_CRC_INIT;
+    const uint8_t* data = (const uint8_t*) record;
+    for( uint8_t i = 0; i < sizeof(JournalRecord) - sizeof(uint8_t); i++ )
+        crc = _crc8_ccitt_update(crc, data[i]);
+    return crc;
+}
@@ -0,0 +1,109 @@
+#ifndef Journal_h
+#define Journal_h
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include "config.h"
+#include "utilities.h"
+#include "Settings.h"
+#include "Interactive.h"
+
+// the ring takes the EEPROM above the settings
+#define JOURNAL_BASE            SETTINGS_END
+#define JOURNAL_NUMRECORDS      ( ( E2END + 1 - JOURNAL_BASE ) / sizeof(JournalRecord) )
+#define JOURNAL_QUEUE_SIZE      4       // status updates waiting for the EEPROM write, each logs its transitions
+#define JOURNAL_PAGE_SIZE       3       // records printed by the QJ command
+#define JOURNAL_CRC_INIT        0x5A
+
+// status bits logged on the transition
+#define JOURNAL_EVENT_MASK      ( _BV(SHUTDOWN_ACTIVE) | _BV(SELF_TEST) | _BV(UPS_FAULT) | _BV(REGULATED) | \
+                                  _BV(BATTERY_LOW) | _BV(UTILITY_FAIL) | _BV(BATTERY_DEAD) | \
+                                  _BV(OUTPUT_CONNECTED) | _BV(OVERLOAD) )
+
+#define JOURNAL_EVENT_SET       0x80    // the bit was set, cleared otherwise
+#define JOURNAL_EVENT_BOOT      16      // power-on, logged with the settled readings
+
+// the sensors fill their windows and the relays switch after the power-on, the status is not logged till then
+#define JOURNAL_SETTLE_TIME     ( 2 * TIMER_ONE_SEC )
+
+/**
+ * @brief JournalRecord is a power event saved in the EEPROM ring. The time is the power-on counter and the uptime,
+ *        as there is no clock.
+ */
+struct __attribute__((packed)) JournalRecord {
+    uint8_t seq;                // incremented with each record, the ring ends where the sequence breaks
+    uint8_t event;              // InteractiveStatusFlags bit | JOURNAL_EVENT_SET, or JOURNAL_EVENT_BOOT
+    uint16_t boot;              // power-on counter
+    uint32_t uptime;            // seconds since the power-on
+    uint16_t input_vac;         // 0.1V
+    uint8_t battery_level;      // %
+    uint16_t duration;          // seconds spent in the previous state, saturated
+    uint8_t crc;                // CRC8 of the fields above
+};
+
+// the transitions of one status update share the readings, so they are queued together and written as
+// a record per bit
+struct JournalEntry {
+    JournalRecord record;       // the readings, the event of the bit being written
+    uint16_t events;            // the status bits changed and not yet written, none for the power-on record
+    uint16_t status;            // the new values of the bits
+};
+
+/**
+ * @brief Journal is the log of the status transitions, kept in the EEPROM ring over resets. The records are queued
+ *        and written by the loop one byte per pass, only when the EEPROM is idle, so the loop is never waiting
+ *        for the EEPROM. The record being written is discarded by its CRC if the power is lost.
+ */
+class Journal {
+    public:
+        // find the end of the ring, call once the settings are loaded
+        void begin();
+
+        // log the transitions of the status bits in JOURNAL_EVENT_MASK, call after regulate(). The power-on is
+        // logged once the status settles and the status is only compared from then
+        void update(uint16_t status, unsigned long ticks, float input_vac, float battery_level);
+
+        // write the next byte of the queued records. Call every loop pass
+        void service();
+
+        // read the record n back from the latest one, false if there is none
+        bool read(uint8_t n, JournalRecord* record);
+
+        // print the number of records, the events dropped since the power-on and the page of JOURNAL_PAGE_SIZE
+        // records, the latest first
+        void print(Print* stream, uint8_t page);
+
+        uint8_t getCount() { return _count; };
+        uint8_t getDropped() { return _dropped; };
+
+    private:
+        // the slot to be written next and the number of saved records
+        uint8_t _head = 0;
+        uint8_t _count = 0;
+
+        uint8_t _seq = 0;
+        uint16_t _boot = 0;
+        bool _booted = false;
+
+        uint16_t _status = 0;
+        uint32_t _last_change = 0;
+
+        JournalEntry _queue[JOURNAL_QUEUE_SIZE];
+        uint8_t _queue_head = 0;
+        uint8_t _queued = 0;
+        uint8_t _write_pos = 0;     // bytes of the record of the queue head written
+        uint8_t _dropped = 0;       // transitions cancelled in the full queue, saturated
+
+        void log(uint16_t events, uint16_t status, uint32_t uptime, float input_vac, float battery_level);
+
+        // fill the event, the sequence and the CRC of the next record of the queue head
+        void seal(JournalEntry* entry);
+
+        bool read_slot(uint8_t slot, JournalRecord* record);
+
+        uint8_t crc(const JournalRecord* record);
+};
+
+#endif
@@ -2,14 +2,25 @@
 
 #ifdef DISPLAY_TYPE_LCD_HD44780
 
+static_assert( DISPLAY_FLUSH_BYTES >= 2, "A character may need the cursor to be moved first" );
+
 void Display::initialize() {
     LiquidCrystal_I2C::init();
     setup_display();
     clear();
 
-    setCursor(5,1);ex_print_str_to_stream(this, MANUFACTURER, true);
+    // the LCD is blank with the cursor at home after clear()
+    memset(_shown, ' ', sizeof(_shown));
+    memset(_frame, ' ', sizeof(_frame));
+    _cursor_col = 0;
+    _cursor_row = 0;
+
+    print_string(5, 1, MANUFACTURER, true);
+    _flush_pos = 0;
+    on_flush(UINT8_MAX);
 
     _update_display_rows = true;
+    init_refresh();
  
 };
 
@@ -38,54 +49,113 @@ void Display::on_refresh() {
     uint16_t status = _lineups->getStatus();
 
 #if DISPLAY_SCREEN_HEIGHT > 2 
-    setCursor(3,0); print_number(_vac_in->reading(), 3,0);
-    setCursor(8,0); print_number(_vac_in->get_frequency() , 4,1);
-    setCursor(16,0);
-    if(!bitRead(status, UTILITY_FAIL)) 
-        printstr(DISPLAY_STATUS_OK);
-    else
-        printstr(DISPLAY_STATUS_NOK);
+    // the numbers are passed in the fixed point with the decimals shown
+    print_number(3, 0, (long) _vac_in->reading(), 3,0);
+    print_number(8, 0, (long)( _vac_in->get_frequency() * 10 ), 4,1);
+    print_string(16, 0, bitRead(status, UTILITY_FAIL) ? DISPLAY_STATUS_NOK : DISPLAY_STATUS_OK);
         
-    setCursor(3,1); print_number(_vac_out->reading(), 3,0); 
-    setCursor(8,1); print_number(_vac_out->get_frequency(), 4,1);
-    setCursor(16,1);
-    if(!bitRead(status, UPS_FAULT)) 
-        printstr(DISPLAY_STATUS_OK);
-    else 
-        printstr(DISPLAY_STATUS_NOK);
-
-    setCursor(3,2); print_number(_v_bat->reading(), 5,2);
-    setCursor(11,2); print_number(_c_bat->reading(), 5,2); 
-    setCursor(2,3); print_number(round((float)_lineups->getBatteryLevel() * 100.00) , 3, 0 );
-    setCursor(9,3); print_number(round((float) 100.00 * _ac_out->reading() / INTERACTIVE_MAX_AC_OUT) , 3, 0 );
-    setCursor(14,3); print_number( status, 2, 0, HEX, true);
-    setCursor(17,3); print_number( HEX * _charger->is_charging() +  _charger->get_mode(), 2, 0, HEX, true);
+    print_number(3, 1, (long) _vac_out->reading(), 3,0); 
+    print_number(8, 1, (long)( _vac_out->get_frequency() * 10 ), 4,1);
+    print_string(16, 1, bitRead(status, UPS_FAULT) ? DISPLAY_STATUS_NOK : DISPLAY_STATUS_OK);
+
+    print_number(3, 2, (long)( _v_bat->reading() * 100 ), 5,2);
+    print_number(11, 2, (long)( _c_bat->reading() * 100 ), 5,2); 
+    print_number(2, 3, round((float)_lineups->getBatteryLevel() * 100.00) , 3, 0 );
+    print_number(9, 3, round((float) 100.00 * _ac_out->reading() / INTERACTIVE_MAX_AC_OUT) , 3, 0 );
+    print_number(14, 3, status, 2, 0, HEX, true);
+    print_number(17, 3, ( _charger->is_charging() << 4 ) | _charger->get_mode(), 2, 0, HEX, true);
 #else
-    setCursor(2,0); print_number(_vac_in->readingR(),3,0);
-    setCursor(9,0); print_number(_vac_out->readingR(),3,0);
-    setCursor(14,0); print_number( _lineups->getStatus(), 2, 0, HEX, true);
-    setCursor(2,1); print_number((float)_lineups->getBatteryLevel() * 100.00 , 3, 0 );
-    setCursor(9,1); print_number(round((float) 100.00 * _ac_out->reading() / INTERACTIVE_MAX_AC_OUT) , 3, 0 );
-    setCursor(14,1); print_number( HEX * _charger->is_charging() +  _charger->get_mode(), 2, 0, HEX, true);
+    print_number(2, 0, (long) _vac_in->readingR(),3,0);
+    print_number(9, 0, (long) _vac_out->readingR(),3,0);
+    print_number(14, 0, _lineups->getStatus(), 2, 0, HEX, true);
+    print_number(2, 1, (long)( _lineups->getBatteryLevel() * 100.00 ), 3, 0 );
+    print_number(9, 1, round((float) 100.00 * _ac_out->reading() / INTERACTIVE_MAX_AC_OUT) , 3, 0 );
+    print_number(14, 1, ( _charger->is_charging() << 4 ) | _charger->get_mode(), 2, 0, HEX, true);
 #endif
 };
 
-void Display::print_number(float val, int len, int dec, int base, bool unsgn) {
+// the values are truncated to the decimals shown, like on_refresh() does
+bool Display::on_update() {
+    uint16_t status = _lineups->getStatus();
+    int16_t charger = ( _charger->is_charging() << 4 ) | _charger->get_mode();
+
+#if DISPLAY_SCREEN_HEIGHT > 2 
+    int16_t values[] = {
+        (int16_t) _vac_in->reading(),
+        (int16_t)( _vac_in->get_frequency() * 10 ),
+        (int16_t) _vac_out->reading(),
+        (int16_t)( _vac_out->get_frequency() * 10 ),
+        (int16_t)( _v_bat->reading() * 100 ),
+        (int16_t)( _c_bat->reading() * 100 ),
+        (int16_t) round( _lineups->getBatteryLevel() * 100.00 ),
+        (int16_t) round( 100.00 * _ac_out->reading() / INTERACTIVE_MAX_AC_OUT ),
+        (int16_t) status,
+        charger
+    };
+#else
+    int16_t values[] = {
+        (int16_t) _vac_in->readingR(),
+        (int16_t) _vac_out->readingR(),
+        (int16_t)( _lineups->getBatteryLevel() * 100.00 ),
+        (int16_t) round( 100.00 * _ac_out->reading() / INTERACTIVE_MAX_AC_OUT ),
+        (int16_t) status,
+        charger
+    };
+#endif
+
+    static_assert( sizeof(values) / sizeof(int16_t) <= DISPLAY_MAX_FIELDS, "Too many display fields" );
+    return update_fields(values, sizeof(values) / sizeof(int16_t));
+}
+
+void Display::print_number(uint8_t col, uint8_t row, long val, int len, int dec, int base, bool unsgn) {
     ex_print_number_to_buf(_buf, val, len, dec, base, unsgn);
-    print(_buf);
+    print_string(col, row, _buf);
+}
+
+void Display::print_string(uint8_t col, uint8_t row, const char* str, bool pgm) {
+    for( ; col < DISPLAY_SCREEN_WIDTH; col++, str++ ) {
+        char c = pgm ? (char) pgm_read_byte(str) : *str;
+        if( !c ) break;
+        _frame[row][col] = c;
+    }
 }
 
-void Display::pgm_print_string(const void* pgm_str) {
-    strcpy_P( _buf, (char*) pgm_read_ptr(pgm_str) );
-    printstr(_buf);
+// the runs of the changed characters are sent, the cursor is moved only at the start of the run
+bool Display::on_flush(uint8_t budget) {
+    for( ; _flush_pos < DISPLAY_SCREEN_HEIGHT * DISPLAY_SCREEN_WIDTH; _flush_pos++ ) {
+        uint8_t row = _flush_pos / DISPLAY_SCREEN_WIDTH;
+        uint8_t col = _flush_pos % DISPLAY_SCREEN_WIDTH;
+
+        if( _frame[row][col] == _shown[row][col] ) continue;
+
+        // the rows are not continuous in the LCD memory, so the cursor is set at the start of each row
+        bool move = ( col != _cursor_col || row != _cursor_row );
+        if( budget < 1 + move ) return false;
+
+        if( move ) {
+            setCursor(col, row);
+            budget--;
+        }
+
+        LiquidCrystal_I2C::write( _frame[row][col] );
+        _shown[row][col] = _frame[row][col];
+        budget--;
+
+        _cursor_col = col + 1;
+        _cursor_row = row;
+    }
+
+    _flush_pos = 0;
+    return true;
 }
 
 void Display::update_display_rows() {
     if(!_update_display_rows) return;
-    for(uint8_t i=0; i< DISPLAY_SCREEN_HEIGHT; i++) {
-        setCursor(0,i);
-        pgm_print_string( &( DISPLAY_ROWS[i] ) ) ;
-    }
+
+    memset(_frame, ' ', sizeof(_frame));
+    for(uint8_t i=0; i< DISPLAY_SCREEN_HEIGHT; i++) 
+        print_string( 0, i, (const char*) pgm_read_ptr( &( DISPLAY_ROWS[i] ) ), true );
+
     _update_display_rows = false;
 }
 
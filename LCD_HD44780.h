@@ -34,6 +34,10 @@ const PROGMEM char* const DISPLAY_ROWS[] = {
 #include "Display.h"
 #include <LiquidCrystal_I2C.h>
 
+/**
+ * @brief Display is rendering the readings to the shadow frame, which is compared with the characters shown by
+ *        the LCD. Each character is a slow I2C transaction, so only the changed ones are sent.
+ */
 class Display : public AbstractDisplay, public LiquidCrystal_I2C {
     public:
         Display(Interactive *lineups, Charger *charger, RMSSensor *vac_in, RMSSensor *vac_out, Sensor *ac_out, Sensor *v_bat, Sensor *c_bat) :
@@ -45,12 +49,27 @@ class Display : public AbstractDisplay, public LiquidCrystal_I2C {
 
     protected:
         void on_refresh() override ;
+        bool on_update() override;
+        bool on_flush(uint8_t budget) override;
         void setup_display() override;
     
     private:
         char _buf[DISPLAY_SCREEN_WIDTH];
-        void print_number(float val, int len , int dec, int base = DEC, bool unsgn = false);
-        void pgm_print_string(const void* str);
+
+        // the frame rendered by on_refresh() and the characters shown by the LCD. Only the differences are sent
+        char _frame[DISPLAY_SCREEN_HEIGHT][DISPLAY_SCREEN_WIDTH];
+        char _shown[DISPLAY_SCREEN_HEIGHT][DISPLAY_SCREEN_WIDTH];
+
+        // position of the LCD cursor, advanced by each character sent
+        uint8_t _cursor_col = 0;
+        uint8_t _cursor_row = 0;
+
+        // next character of the frame to be compared by on_flush()
+        uint8_t _flush_pos = 0;
+
+        // render into the frame, the text is clipped at the end of the row
+        void print_number(uint8_t col, uint8_t row, long val, int len , int dec, int base = DEC, bool unsgn = false);
+        void print_string(uint8_t col, uint8_t row, const char* str, bool pgm = false);
 
         uint8_t _update_display_rows;
         void update_display_rows();
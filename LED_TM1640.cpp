@@ -2,20 +2,24 @@
 
 #ifdef DISPLAY_TYPE_LED_TM1640
 
+static_assert( DISPLAY_FLUSH_BYTES >= 2, "A grid is sent by its address and data" );
+
 void Display::initialize() {
+    // the grids are blank after begin()
+    TM1640Port::begin();
+    memset(sent, 0x0, sizeof(sent));
+
     setup_display();
+    init_refresh();
 }
 
 void Display::setup_display() {
-    sendCommand(TM16XX_CMD_DATA_FIXED);
-    TM1640::setupDisplay(_active, _brightness);
+    TM1640Port::setupDisplay(_active, _brightness);
 }
 
 void Display::on_refresh() {
-    
-    _blink_state = !_blink_state; 
 
-    clear(false);
+    clear();
 
     switch(_display_mode) {
         case DISPLAY_FREQ:
@@ -48,10 +52,34 @@ void Display::on_refresh() {
                 ( _lineups->readStatus( UNUSUAL_STATE ) ? UNUSUAL_MODE_INDICATOR : 0) |
                 ( _lineups->readStatus( UPS_FAULT ) ? UPS_FAULT_INDICATOR : 0) );
 
-    show();
+}
+
+
+// the readings are truncated to int like setInputReading() does, the level segments and their blink thresholds
+// are multiples of 1/40
+bool Display::on_update() {
+    bool freq = ( _display_mode == DISPLAY_FREQ );
 
+    int16_t values[] = {
+        (int16_t)( freq ? _vac_in->get_frequency() : _vac_in->readingR() ),
+        (int16_t)( freq ? _vac_out->get_frequency() : _vac_out->readingR() ),
+        (int16_t) ceil( _lineups->getBatteryLevel() * 40 ),
+        (int16_t) ceil( _ac_out->reading() / INTERACTIVE_MAX_AC_OUT * 40 ),
+        (int16_t) _lineups->getStatus(),
+        (int16_t)( _lineups->isBatteryMode() | ( _charger->get_mode() << 1 ) )
+    };
+
+    return update_fields(values, sizeof(values) / sizeof(int16_t));
 }
 
+bool Display::on_heartbeat() {
+    _blink_state = !_blink_state;
+
+    for( uint8_t i = 0; i < DISPLAY_MAX_POS; i++ ) 
+        if( blink[i] ) return true;
+
+    return false;
+}
 
 void Display::setInputReading(int reading, ReadingUnit mode ) {
     setReading( reading, mode, 2, 0 );
@@ -62,13 +90,13 @@ void Display::setOutputReading( int reading, ReadingUnit mode ) {
 }
 
 void Display::setReading( int reading, ReadingUnit mode, int start, int stop ) {
-    int digits = reading;
-    int base = ( !mode ? 16 : 10 );
+    // the digits are taken from the nibbles, the decimal reading is converted to BCD
+    uint32_t digits = ( !mode ? (uint16_t) reading : ex_to_bcd(reading) );
     for( int grid = start; grid >= stop; grid-- ) {
         uint8_t grid_mode = grid - stop;
         uint8_t mod_flag = ( mode > 0 ) && ( grid_mode == mode ) ;
-        board[grid] = pgm_read_byte( DISPLAY_NUMBER_FONT + ( digits % base ) ) | mod_flag;
-        digits /= base;
+        board[grid] = pgm_read_byte( DISPLAY_NUMBER_FONT + ( digits & 0x0F ) ) | mod_flag;
+        digits >>= 4;
         if(!digits) break;
     }
 }
@@ -85,7 +113,7 @@ void Display::setLevel( float level, bool isHI , ReadingDirection direction ) {
     uint16_t flags = 0;
     uint16_t blink_segment = 0;
 
-    uint16_t* display_level = ( isHI ? DISPLAY_BATTERY_LEVEL : DISPLAY_LOAD_LEVEL );
+    const uint16_t* display_level = ( isHI ? DISPLAY_BATTERY_LEVEL : DISPLAY_LOAD_LEVEL );
 
     if( level > 0.0F ) 
         for( int ptr = 0; ptr < DISPLAY_LEVEL_N_SEGMENTS; ptr++ ) {
@@ -112,14 +140,14 @@ void Display::setLevel( float level, bool isHI , ReadingDirection direction ) {
     
 }
 
-void Display::setFlag(DisplayFlag flag) {
-    board[FLAG_HI_GRID] |= highByte((uint16_t) flag);
-    board[FLAG_LO_GRID] |= lowByte((uint16_t) flag);
+void Display::setFlag(uint16_t flags) {
+    board[FLAG_HI_GRID] |= highByte(flags);
+    board[FLAG_LO_GRID] |= lowByte(flags);
 }
 
-void Display::setBlink(DisplayFlag flag) {
-    blink[FLAG_HI_GRID] |= highByte((uint16_t) flag);
-    blink[FLAG_LO_GRID] |= lowByte((uint16_t) flag);
+void Display::setBlink(uint16_t flags) {
+    blink[FLAG_HI_GRID] |= highByte(flags);
+    blink[FLAG_LO_GRID] |= lowByte(flags);
 }
 
 void Display::setRelayStatus( bool rly_status, uint8_t grid ) {
@@ -127,21 +155,26 @@ void Display::setRelayStatus( bool rly_status, uint8_t grid ) {
 }
 
 
-void Display::clear(bool clear_display) {
-    if(clear_display) clearDisplay(); 
+void Display::clear() {
     memset(board, 0x0, sizeof(board));
     memset(blink, 0x0, sizeof(blink));
 }
 
-void Display::show() {
-    sendCommand(TM16XX_CMD_DATA_AUTO);
-    start();
-    send(TM16XX_CMD_ADDRESS | 0x0);	
-    for( int i = 0; i < DISPLAY_MAX_POS; i++ ) {
-        send( ( _blink_state? board[i] ^ blink[i] : board[i] ));
+// only the changed grids are sent, each one by its address
+bool Display::on_flush(uint8_t budget) {
+    for( ; _flush_pos < DISPLAY_MAX_POS; _flush_pos++ ) {
+        uint8_t data = ( _blink_state? board[_flush_pos] ^ blink[_flush_pos] : board[_flush_pos] );
+        if( data == sent[_flush_pos] ) continue;
+
+        if( budget < 2 ) return false;
+
+        sendGrid(_flush_pos, data);
+        sent[_flush_pos] = data;
+        budget -= 2;
     }
-    stop();
 
+    _flush_pos = 0;
+    return true;
 }
 
 #endif
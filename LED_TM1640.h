@@ -6,7 +6,7 @@
 #ifdef DISPLAY_TYPE_LED_TM1640
 
 #include "Display.h"
-#include <TM1640.h> 
+#include "TM1640Port.h"
 
 #define DISPLAY_MAX_POS         8   // max number of used groups  
 
@@ -86,24 +86,30 @@ const PROGMEM uint8_t DISPLAY_NUMBER_FONT[] = {
   };
 
 
-  class Display : public AbstractDisplay, public TM1640 {
+  /**
+   * @brief Display is rendering the readings to the board and the blink mask. Only the grids which differ from
+   *        the ones sent before are written to the TM1640, so the blinking sends only the grids with the blink mask.
+   */
+  class Display : public AbstractDisplay, public TM1640Port {
     public:
         Display(Interactive *lineups, Charger *charger, RMSSensor *vac_in, RMSSensor *vac_out, Sensor *ac_out, Sensor *v_bat, Sensor *c_bat) :
-            AbstractDisplay(lineups, charger, vac_in, vac_out, ac_out, v_bat, c_bat), 
-            TM1640(DISPLAY_DA_OUT, DISPLAY_CLK_OUT, DISPLAY_MAX_POS) {
+            AbstractDisplay(lineups, charger, vac_in, vac_out, ac_out, v_bat, c_bat) {
             _blink_state = false;
             _display_mode = DISPLAY_VOLTAGE;
         }; 
 
         void initialize() override;
 
-        void toggle_display_mode() { _display_mode = (++_display_mode) % DISPLAY_NUMMODES ;};
-        void set_display_mode(uint8_t mode) { _display_mode = mode; };
+        void toggle_display_mode() { _display_mode = ( _display_mode + 1 ) % DISPLAY_NUMMODES; init_refresh(); };
+        void set_display_mode(uint8_t mode) { _display_mode = mode; init_refresh(); };
         uint8_t get_display_mode() { return _display_mode; };
      
     
     protected:
         void on_refresh() override;
+        bool on_update() override;
+        bool on_heartbeat() override;
+        bool on_flush(uint8_t budget) override;
         void setup_display() override;
 
     private:
@@ -137,17 +143,19 @@ const PROGMEM uint8_t DISPLAY_NUMBER_FONT[] = {
 
         uint8_t board[8];   // array to store display data for each group
         uint8_t blink[8];    // array to store blink mask for each group
+        uint8_t sent[8];     // grids written to the TM1640
 
         bool _blink_state;
         uint8_t _display_mode;
 
-        void setFlag(DisplayFlag flag);
+        // next grid to be compared by on_flush()
+        uint8_t _flush_pos = 0;
 
-        void setBlink(DisplayFlag flag);
+        void setFlag(uint16_t flags);
 
-        void show();
-        
-        void clear(bool clear_display = true);
+        void setBlink(uint16_t flags);
+
+        void clear();
        
 };
 
@@ -0,0 +1,24 @@
+#include "VoltronicCommands.h"
+
+// The command table of the Megatec (Q1) protocol, sorted by the key. The Q1 status has the same layout
+// as QS of Voltronic, so both dialects share the handlers and the pre-rendered responses
+constexpr CommandEntry MEGATEC_COMMANDS[] PROGMEM = {
+    { "C",   "",                                        nullptr,            COMMAND_SHUTDOWN_CANCEL },
+    { "CT",  "",                                        nullptr,            COMMAND_SELF_TEST_CANCEL },
+    { "F",   "",                                        cmd_rating,         COMMAND_NONE },
+    { "I",   "",                                        cmd_info,           COMMAND_NONE },
+    // 'undocumented' - MN switches to the protocol dialect N, see README
+    { "M",   ARG_DIGIT,                                 cmd_dialect,        COMMAND_SELECT_DIALECT },
+    { "M",   "",                                        cmd_protocol,       COMMAND_NONE },
+    { "Q",   "1",                                       cmd_status,         COMMAND_NONE },
+    { "Q",   "",                                        nullptr,            COMMAND_BEEPER_MUTE },
+    { "S",   ARG_MINUTES ARG_OPTIONAL "R" ARG_RESTORE,  cmd_shutdown,       COMMAND_SHUTDOWN },
+    { "T",   ARG_OPTIONAL ARG_MINUTES,                  cmd_self_test,      COMMAND_SELF_TEST },
+    { "TL",  "",                                        nullptr,            COMMAND_DEEP_TEST }
+};
+
+const uint8_t MEGATEC_NUM_COMMANDS = sizeof(MEGATEC_COMMANDS) / sizeof(CommandEntry);
+
+static_assert( command_table_sorted(MEGATEC_COMMANDS, MEGATEC_NUM_COMMANDS), "Megatec command table must be sorted by the key" );
+
+const CommandDialect MEGATEC_DIALECT = { MEGATEC_PROTOCOL, MEGATEC_COMMANDS, MEGATEC_NUM_COMMANDS };
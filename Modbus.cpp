@@ -0,0 +1,413 @@
+#include "Modbus.h"
+
+#define MODBUS_NO_STATUS            0xFF    // the coil is not mapped to a status bit
+#define MODBUS_INPUT_STATUS         0xF0    // the status bits of QS
+#define MODBUS_INPUT_GRAND_STATUS   0xF1    // the status bits of QGS
+
+const CommandDialect MODBUS_DIALECT = { MODBUS_PROTOCOL, nullptr, 0 };
+
+// CRC-16/MODBUS of all bytes, reflected polynomial 0xA001
+static const uint16_t MODBUS_CRC_TABLE[256] PROGMEM = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040};
+
+uint16_t modbus_crc(const uint8_t* buf, uint8_t len) {
+    uint16_t crc = 0xFFFF;
+    while( len-- ) 
+        crc = ( crc >> 8 ) ^ pgm_read_word( &MODBUS_CRC_TABLE[ lowByte( crc ^ *buf++ ) ] );
+    return crc;
+}
+
+// input registers, the param of the protocol and its scale
+struct ModbusInput {
+    uint8_t param;
+    uint8_t scale;
+};
+
+constexpr ModbusInput MODBUS_INPUTS[] PROGMEM = {
+    { PARAM_INPUT_VAC,              10 },
+    { PARAM_INPUT_FAULT_VAC,        10 },
+    { PARAM_INPUT_FREQ,             10 },
+    { PARAM_OUTPUT_VAC,             10 },
+    { PARAM_OUTPUT_FREQ,            10 },
+    { PARAM_OUTPUT_LOAD_LEVEL,      100 },
+    { PARAM_OUTPUT_AC,              100 },
+    { PARAM_BATTERY_VDC,            100 },
+    { PARAM_BATTERY_LEVEL,          100 },
+    { PARAM_REMAINING_MIN,          1 },
+    { PARAM_INTERNAL_TEMP,          10 },
+    { MODBUS_INPUT_STATUS,          1 },
+    { MODBUS_INPUT_GRAND_STATUS,    1 }
+};
+
+const uint8_t MODBUS_NUM_INPUTS = sizeof(MODBUS_INPUTS) / sizeof(ModbusInput);
+
+// coils, the status bit and the commands to switch it on and off. 
+// The command toggling the state is only issued if the state is different
+struct ModbusCoilEntry {
+    uint8_t status_bit;
+    uint8_t on;
+    uint8_t off;
+};
+
+constexpr ModbusCoilEntry MODBUS_COILS[MODBUS_NUM_COILS] PROGMEM = {
+    { STATUS_BEEPER_ACTIVE,     COMMAND_BEEPER_MUTE,    COMMAND_BEEPER_MUTE },
+    { STATUS_SELFTEST,          COMMAND_SELF_TEST,      COMMAND_SELF_TEST_CANCEL },
+    { STATUS_SELFTEST,          COMMAND_DEEP_TEST,      COMMAND_SELF_TEST_CANCEL },
+    { STATUS_SHUTDOWN_ACTIVE,   COMMAND_SHUTDOWN,       COMMAND_SHUTDOWN_CANCEL },
+    { MODBUS_NO_STATUS,         COMMAND_SAVE_SENSORS,   COMMAND_NONE }
+};
+
+
+Modbus::Modbus(UART* stream, Voltronic* protocol, SensorManager* sensors, Charger* charger) {
+    _stream = stream;
+    _protocol = protocol;
+    _sensors = sensors;
+    _charger = charger;
+}
+
+ExecuteCommand Modbus::process() {
+
+    while( _stream->available() ) {
+        uint8_t ch = _stream->read();
+
+        // too long frame is dropped as a whole
+        if( _frame_len < MODBUS_FRAME_SIZE ) _frame[_frame_len] = ch;
+        if( _frame_len < 0xFF ) _frame_len++;
+    }
+
+    // the frame is complete after the silence
+    if( !_frame_len || _stream->rx_idle() < MODBUS_T35_MS ) return COMMAND_NONE;
+
+    ExecuteCommand command = COMMAND_NONE;
+
+    // the CRC over the frame including its own CRC is 0. Frames of the supported functions are 8 bytes at least
+    if( _frame_len >= 8 && _frame_len <= MODBUS_FRAME_SIZE && !modbus_crc(_frame, _frame_len) )
+        command = handle_frame();
+
+    _frame_len = 0;
+
+    return command;
+}
+
+ExecuteCommand Modbus::handle_frame() {
+
+    ExecuteCommand command = COMMAND_NONE;
+
+    if( _frame[0] != MODBUS_SLAVE_ADDRESS && _frame[0] != MODBUS_BROADCAST ) return command;
+
+    uint16_t start = word( _frame[2], _frame[3] );
+    uint16_t value = word( _frame[4], _frame[5] );
+
+    // write requests are confirmed by their first 6 bytes
+    uint8_t len = 6;
+    uint8_t error = MODBUS_OK;
+
+    switch( _frame[1] ) {
+        case MODBUS_READ_COILS:
+            error = read_coils(start, value);
+            len = 3 + _frame[2];
+            break;
+        case MODBUS_READ_HOLDING:
+        case MODBUS_READ_INPUT:
+            error = read_registers(start, value, _frame[1] == MODBUS_READ_INPUT);
+            len = 3 + _frame[2];
+            break;
+        case MODBUS_WRITE_COIL:
+            error = write_coil(start, value, &command);
+            break;
+        case MODBUS_WRITE_REGISTER:
+            error = write_register(start, value, &command);
+            break;
+        case MODBUS_WRITE_REGISTERS:
+            if( !value || value > MODBUS_MAX_REGS || _frame[6] != 2 * value || _frame_len != 9 + 2 * value ) {
+                error = MODBUS_ILLEGAL_VALUE;
+                break;
+            }
+            // the float params are written as whole, by the aligned pairs of the registers
+            if( start >= MODBUS_PARAMS_BASE && ( ( start | value ) & 0x01 ) ) {
+                error = MODBUS_ILLEGAL_ADDRESS;
+                break;
+            }
+            error = write_registers(start, value, &command);
+            break;
+        default:
+            error = MODBUS_ILLEGAL_FUNCTION;
+    }
+
+    // the rejected request is not executed
+    if( error ) command = COMMAND_NONE;
+
+    // broadcast is not answered
+    if( _frame[0] == MODBUS_BROADCAST ) return command;
+
+    if( error ) {
+        _frame[1] |= 0x80;
+        _frame[2] = error;
+        len = 3;
+    }
+
+    send(len);
+
+    return command;
+}
+
+uint8_t Modbus::read_coils(uint16_t start, uint16_t count) {
+    if( !count || count > MODBUS_NUM_COILS ) return MODBUS_ILLEGAL_VALUE;
+    if( start + count > MODBUS_NUM_COILS ) return MODBUS_ILLEGAL_ADDRESS;
+
+    _frame[2] = ( count + 7 ) / 8;
+    memset( _frame + 3, 0, _frame[2] );
+
+    for( uint8_t i = 0; i < count; i++ ) {
+        ModbusCoilEntry coil;
+        memcpy_P( &coil, &MODBUS_COILS[start + i], sizeof(ModbusCoilEntry) );
+
+        if( coil.status_bit != MODBUS_NO_STATUS && bitRead( _protocol->getStatus(), coil.status_bit ) ) 
+            bitSet( _frame[3 + i / 8], i % 8 );
+    }
+
+    return MODBUS_OK;
+}
+
+uint8_t Modbus::read_registers(uint16_t start, uint16_t count, bool input) {
+    if( !count || count > MODBUS_MAX_REGS ) return MODBUS_ILLEGAL_VALUE;
+
+    _frame[2] = 2 * count;
+
+    for( uint8_t i = 0; i < count; i++ ) {
+        uint16_t value;
+        uint8_t error = input ? read_input(start + i, &value) : read_holding(start + i, &value);
+        if( error ) return error;
+
+        _frame[3 + 2 * i] = highByte(value);
+        _frame[4 + 2 * i] = lowByte(value);
+    }
+
+    return MODBUS_OK;
+}
+
+uint8_t Modbus::write_coil(uint16_t coil, uint16_t value, ExecuteCommand* command) {
+    if( coil >= MODBUS_NUM_COILS ) return MODBUS_ILLEGAL_ADDRESS;
+    if( value != 0xFF00 && value != 0x0000 ) return MODBUS_ILLEGAL_VALUE;
+
+    ModbusCoilEntry entry;
+    memcpy_P( &entry, &MODBUS_COILS[coil], sizeof(ModbusCoilEntry) );
+
+    bool on = ( value == 0xFF00 );
+
+    if( entry.on == entry.off && entry.status_bit != MODBUS_NO_STATUS && 
+        bitRead( _protocol->getStatus(), entry.status_bit ) == on ) 
+        return MODBUS_OK;
+
+    *command = (ExecuteCommand) ( on ? entry.on : entry.off );
+
+    // the quick test is run for the default duration
+    if( *command == COMMAND_SELF_TEST && _protocol->getParam(PARAM_SELFTEST_MIN) < MIN_SELFTEST_DURATION ) 
+        _protocol->setParam(PARAM_SELFTEST_MIN, MIN_SELFTEST_DURATION);
+
+    return MODBUS_OK;
+}
+
+uint8_t Modbus::write_registers(uint16_t start, uint8_t count, ExecuteCommand* command) {
+    uint8_t error = MODBUS_OK;
+
+    for( uint8_t write = 0; write < 2 && !error; write++ ) {
+        for( uint8_t i = 0; i < count && !error; i++ ) {
+            uint16_t reg = start + i;
+            uint16_t data = word( _frame[7 + 2 * i], _frame[8 + 2 * i] );
+            if( reg < MODBUS_PARAMS_BASE ) 
+                error = write ? write_register(reg, data, command) : check_register(reg, data);
+            else {
+                i++;
+                error = write ? write_float(reg, data, word( _frame[7 + 2 * i], _frame[8 + 2 * i] )) : check_float(reg);
+            }
+        }
+    }
+
+    return error;
+}
+
+uint8_t Modbus::check_register(uint16_t reg, uint16_t value) {
+
+    switch( reg ) {
+        case MODBUS_HOLDING_SELFTEST_MIN:
+        case MODBUS_HOLDING_SHUTDOWN_MIN:
+        case MODBUS_HOLDING_RESTORE_MIN:
+            return MODBUS_OK;
+        case MODBUS_HOLDING_DIALECT:
+            return value < NUM_DIALECTS ? MODBUS_OK : MODBUS_ILLEGAL_VALUE;
+        case MODBUS_HOLDING_CHARGE_PROFILE:
+            return value < CHARGE_NUM_PROFILES ? MODBUS_OK : MODBUS_ILLEGAL_VALUE;
+        default:
+            // a half of the float param is not written alone, the regulation would get a garbage value
+            return MODBUS_ILLEGAL_ADDRESS;
+    }
+}
+
+uint8_t Modbus::check_float(uint16_t reg) {
+    float param;
+    return ( ( reg & 0x01 ) || !get_float(reg, &param) ) ? MODBUS_ILLEGAL_ADDRESS : MODBUS_OK;
+}
+
+uint8_t Modbus::write_register(uint16_t reg, uint16_t value, ExecuteCommand* command) {
+    uint8_t error = check_register(reg, value);
+    if( error ) return error;
+
+    switch( reg ) {
+        case MODBUS_HOLDING_SELFTEST_MIN:
+            _protocol->setParam(PARAM_SELFTEST_MIN, max( value / 10.0F, MIN_SELFTEST_DURATION ));
+            break;
+        case MODBUS_HOLDING_SHUTDOWN_MIN:
+            _protocol->setParam(PARAM_SHUTDOWN_MIN, value / 10.0F);
+            break;
+        case MODBUS_HOLDING_RESTORE_MIN:
+            _protocol->setParam(PARAM_RESTORE_MIN, value);
+            break;
+        case MODBUS_HOLDING_DIALECT:
+            _protocol->selectDialect(value);
+            *command = COMMAND_SELECT_DIALECT;
+            break;
+        case MODBUS_HOLDING_CHARGE_PROFILE:
+            _charger->set_profile(value);
+            break;
+    }
+
+    return MODBUS_OK;
+}
+
+uint8_t Modbus::write_float(uint16_t reg, uint16_t high, uint16_t low) {
+    uint8_t error = check_float(reg);
+    if( error ) return error;
+
+    float param;
+    uint32_t bits = ( (uint32_t) high << 16 ) | low;
+    memcpy( &param, &bits, sizeof(float) );
+
+    set_float(reg, param);
+
+    return MODBUS_OK;
+}
+
+uint8_t Modbus::read_input(uint16_t reg, uint16_t* value) {
+    if( reg >= MODBUS_NUM_INPUTS ) return MODBUS_ILLEGAL_ADDRESS;
+
+    ModbusInput input;
+    memcpy_P( &input, &MODBUS_INPUTS[reg], sizeof(ModbusInput) );
+
+    switch( input.param ) {
+        case MODBUS_INPUT_STATUS:
+            *value = _protocol->getStatus();
+            break;
+        case MODBUS_INPUT_GRAND_STATUS:
+            *value = _protocol->getGrandStatus();
+            break;
+        default:
+            *value = (int16_t) lround( _protocol->getParam(input.param) * input.scale );
+    }
+
+    return MODBUS_OK;
+}
+
+uint8_t Modbus::read_holding(uint16_t reg, uint16_t* value) {
+    float param;
+
+    switch( reg ) {
+        case MODBUS_HOLDING_SELFTEST_MIN:
+            *value = lround( _protocol->getParam(PARAM_SELFTEST_MIN) * 10 );
+            break;
+        case MODBUS_HOLDING_SHUTDOWN_MIN:
+            *value = lround( _protocol->getParam(PARAM_SHUTDOWN_MIN) * 10 );
+            break;
+        case MODBUS_HOLDING_RESTORE_MIN:
+            *value = (uint16_t) _protocol->getParam(PARAM_RESTORE_MIN);
+            break;
+        case MODBUS_HOLDING_DIALECT:
+            *value = _protocol->getDialect();
+            break;
+        case MODBUS_HOLDING_CHARGE_PROFILE:
+            *value = _charger->get_profile();
+            break;
+        default:
+            if( !get_float(reg, &param) ) return MODBUS_ILLEGAL_ADDRESS;
+
+            uint32_t bits;
+            memcpy( &bits, &param, sizeof(float) );
+            *value = ( reg & 0x01 ) ? (uint16_t) bits : (uint16_t)( bits >> 16 );
+    }
+
+    return MODBUS_OK;
+}
+
+bool Modbus::get_float(uint16_t reg, float* value) {
+    if( reg < MODBUS_PARAMS_BASE ) return false;
+
+    uint16_t device = ( reg - MODBUS_PARAMS_BASE ) / MODBUS_PARAMS_STRIDE;
+    uint8_t param = ( ( reg - MODBUS_PARAMS_BASE ) % MODBUS_PARAMS_STRIDE ) / 2;
+
+    if( device < _sensors->get_num_sensors() && param < SENSOR_NUMPARAMS ) 
+        *value = _sensors->get(device)->getParam( (SensorParam) param );
+    else if( device == _sensors->get_num_sensors() && param < CHARGING_NUMPARAM ) 
+        *value = _charger->getParam( (ChargerPIDParam) param );
+    else
+        return false;
+
+    return true;
+}
+
+void Modbus::set_float(uint16_t reg, float value) {
+    uint16_t device = ( reg - MODBUS_PARAMS_BASE ) / MODBUS_PARAMS_STRIDE;
+    uint8_t param = ( ( reg - MODBUS_PARAMS_BASE ) % MODBUS_PARAMS_STRIDE ) / 2;
+
+    if( device < _sensors->get_num_sensors() ) {
+        Sensor* sensor = _sensors->get(device);
+        // battery sensors are also computed in the charger slot
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            sensor->setParam( value, (SensorParam) param );
+            sensor->compute_reading();
+        }
+    }
+    else {
+        _charger->setParam( value, (ChargerPIDParam) param );
+    }
+}
+
+void Modbus::send(uint8_t len) {
+    uint16_t crc = modbus_crc(_frame, len);
+    _frame[len++] = lowByte(crc);
+    _frame[len++] = highByte(crc);
+
+    // the master repeats the request if the response is dropped
+    if( _stream->availableForWrite() >= len ) 
+        _stream->write(_frame, len);
+}
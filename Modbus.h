@@ -0,0 +1,112 @@
+#ifndef Modbus_h
+#define Modbus_h
+
+#include <Arduino.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "UART.h"
+#include "Voltronic.h"
+#include "Sensor.h"
+#include "Charger.h"
+
+#define MODBUS_BROADCAST        0
+#define MODBUS_MAX_REGS         32      // max number of registers in a request
+#define MODBUS_FRAME_SIZE       ( 9 + 2 * MODBUS_MAX_REGS )
+
+// silence of 3.5 symbols (11 bits each) ends the frame, 1.75ms above 19200bps
+#define MODBUS_T35_MS           ( SERIAL_MONITOR_BAUD_RATE > 19200 ? 2 : 38500UL / SERIAL_MONITOR_BAUD_RATE + 1 )
+
+// float params of the sensors and the charger, 2 registers each (high word first), 16 registers per device
+#define MODBUS_PARAMS_BASE      0x100
+#define MODBUS_PARAMS_STRIDE    16
+
+enum ModbusFunction {
+    MODBUS_READ_COILS = 0x01,
+    MODBUS_READ_HOLDING = 0x03,
+    MODBUS_READ_INPUT = 0x04,
+    MODBUS_WRITE_COIL = 0x05,
+    MODBUS_WRITE_REGISTER = 0x06,
+    MODBUS_WRITE_REGISTERS = 0x10
+};
+
+enum ModbusException {
+    MODBUS_OK,
+    MODBUS_ILLEGAL_FUNCTION,
+    MODBUS_ILLEGAL_ADDRESS,
+    MODBUS_ILLEGAL_VALUE
+};
+
+// coils, read from the status bits and written as the commands
+enum ModbusCoil {
+    MODBUS_COIL_BEEPER,
+    MODBUS_COIL_SELF_TEST,
+    MODBUS_COIL_DEEP_TEST,
+    MODBUS_COIL_SHUTDOWN,           // the delay is set by the holding register, 0 - immediately
+    MODBUS_COIL_SAVE_PARAMS,
+    MODBUS_NUM_COILS
+};
+
+// holding registers below MODBUS_PARAMS_BASE
+enum ModbusHolding {
+    MODBUS_HOLDING_SELFTEST_MIN,    // x10
+    MODBUS_HOLDING_SHUTDOWN_MIN,    // x10
+    MODBUS_HOLDING_RESTORE_MIN,
+    MODBUS_HOLDING_DIALECT,         // write 0 or 1 to get back to the text protocol
+    MODBUS_HOLDING_CHARGE_PROFILE,
+    MODBUS_NUM_HOLDING
+};
+
+uint16_t modbus_crc(const uint8_t* buf, uint8_t len);
+
+/**
+ * @brief Modbus is the RTU slave sharing the serial port with the text protocol. Input registers are mapped to
+ *        the params published by the Voltronic protocol once per sensor window, so both protocols report the
+ *        same snapshot. Holding registers are the sensor and charger params, coils are the commands executed
+ *        by the main loop. The frame ends after the silence of 3.5 symbols, timed by the UART interrupt.
+ */
+class Modbus {
+    public:
+        Modbus(UART* stream, Voltronic* protocol, SensorManager* sensors, Charger* charger);
+
+        // read the input and handle the complete frame. Returns the command to be executed by the main loop
+        ExecuteCommand process();
+
+    private:
+        UART* _stream;
+        Voltronic* _protocol;
+        SensorManager* _sensors;
+        Charger* _charger;
+
+        // the request is replaced by the response in place
+        uint8_t _frame[MODBUS_FRAME_SIZE];
+        uint8_t _frame_len = 0;
+
+        ExecuteCommand handle_frame();
+
+        uint8_t read_coils(uint16_t start, uint16_t count);
+        uint8_t read_registers(uint16_t start, uint16_t count, bool input);
+        uint8_t write_coil(uint16_t coil, uint16_t value, ExecuteCommand* command);
+        uint8_t write_register(uint16_t reg, uint16_t value, ExecuteCommand* command);
+
+        // write the float param at the even holding register from the pair of the registers
+        uint8_t write_float(uint16_t reg, uint16_t high, uint16_t low);
+
+        // the error the writes above would return, without writing
+        uint8_t check_register(uint16_t reg, uint16_t value);
+        uint8_t check_float(uint16_t reg);
+
+        // check all the registers of the request and only then write them, so a rejected request changes nothing
+        uint8_t write_registers(uint16_t start, uint8_t count, ExecuteCommand* command);
+
+        uint8_t read_input(uint16_t reg, uint16_t* value);
+        uint8_t read_holding(uint16_t reg, uint16_t* value);
+
+        // float param of the sensor or the charger at the holding register, false if there is none
+        bool get_float(uint16_t reg, float* value);
+        void set_float(uint16_t reg, float value);
+
+        void send(uint8_t len);
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "PID.h"
+
+PID::PID(int16_t out_min, int16_t out_max) {
+    _out_min = out_min;
+    _out_max = out_max;
+    _bias = 0;
+    _kp = _ki = _kd = 0;
+    _derivative_mode = PID_DERIVATIVE_ON_MEASUREMENT;
+    reset();
+}
+
+void PID::setTunings(float kp, float ki, float kd) {
+    _kp = (int32_t) round( constrain(kp, 0.0F, PID_MAX_KP) * ( 1L << PID_GAIN_SHIFT ) );
+    _ki = (int32_t) round( constrain(ki, 0.0F, PID_MAX_KI) * ( 1L << PID_KI_SHIFT ) );
+    _kd = (int32_t) round( constrain(kd, 0.0F, PID_MAX_KD) * ( 1L << PID_GAIN_SHIFT ) );
+}
+
+void PID::reset() {
+    _integral = 0;
+    _last_error = 0;
+    _last_measurement = 0;
+    _initialized = false;
+    _output = 0;
+}
+
+int16_t PID::compute(int32_t error, int32_t measurement, uint16_t elapsed) {
+
+    const int32_t out_min = (int32_t) _out_min << PID_OUTPUT_SHIFT;
+    const int32_t out_max = (int32_t) _out_max << PID_OUTPUT_SHIFT;
+
+    error = constrain(error, -PID_MAX_ERROR, PID_MAX_ERROR);
+    elapsed = constrain(elapsed, 1, PID_MAX_ELAPSED);
+
+    // proportional term
+    int32_t p = ( _kp * error ) >> PID_GAIN_SHIFT;
+
+    // derivative term, skipped on the first call after reset
+    int32_t d = 0;
+    if( _initialized ) {
+        int32_t delta = ( _derivative_mode == PID_DERIVATIVE_ON_MEASUREMENT ) ?
+                            _last_measurement - measurement :
+                            error - _last_error;
+        delta = constrain(delta, -PID_MAX_ERROR, PID_MAX_ERROR);
+        d = ( ( _kd * delta ) >> PID_GAIN_SHIFT ) / elapsed;
+    }
+
+    p = constrain(p, -out_max - out_max, out_max + out_max);
+    d = constrain(d, -out_max - out_max, out_max + out_max);
+
+    int32_t bias = (int32_t) _bias << PID_OUTPUT_SHIFT;
+    int32_t output = p + integral() + d + bias;
+
+    // conditional integration: hold the integral while the output is saturated in the direction of the error
+    if( !( ( output >= out_max && error > 0 ) || ( output <= out_min && error < 0 ) ) ) {
+        // accumulated at the full precision of Ki, so the small errors are neither lost nor floored
+        const int64_t limit = (int64_t)( out_max - out_min ) << PID_KI_SHIFT;
+        _integral += (int64_t) _ki * ( error * elapsed );
+        _integral = constrain(_integral, -limit, limit);
+        output = p + integral() + d + bias;
+    }
+
+    _last_error = error;
+    _last_measurement = measurement;
+    _initialized = true;
+
+    _output = (int16_t) constrain( output >> PID_OUTPUT_SHIFT, (int32_t) _out_min, (int32_t) _out_max );
+
+    return _output;
+}
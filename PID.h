@@ -0,0 +1,88 @@
+#ifndef PID_h
+#define PID_h
+
+#include <Arduino.h>
+
+// Fixed point formats used by the regulator
+#define PID_ERROR_SHIFT     10      // errors are relative to the target, Q10 (1024 = 100%)
+#define PID_GAIN_SHIFT      8       // proportional and derivative gains, Q8
+#define PID_KI_SHIFT        16      // integral gain, Q16
+#define PID_OUTPUT_SHIFT    10      // internal output accumulator, Q10
+
+const int32_t PID_ONE = 1L << PID_ERROR_SHIFT;
+
+// relative errors are clamped to +/-200% so that the products fit in 32 bit
+const int32_t PID_MAX_ERROR = 2 * PID_ONE;
+
+// gain limits keeping the products within 32 bit, the integral is accumulated in 64 bit
+const float PID_MAX_KP = 4095.0F;
+const float PID_MAX_KI = 4095.0F;
+const float PID_MAX_KD = 4095.0F;
+
+// max time step, longer gaps are integrated as this value
+const uint16_t PID_MAX_ELAPSED = 100;
+
+enum PIDDerivativeMode {
+    PID_DERIVATIVE_ON_ERROR,
+    PID_DERIVATIVE_ON_MEASUREMENT
+};
+
+/**
+ * @brief PID is a fixed point PID regulator. Gains are set as float and converted to the fixed point,
+ *        then all the calculations are done in 32 bit integers. The integral and derivative terms
+ *        are scaled by the number of time steps elapsed between the calls.
+ *        Windup is prevented by the conditional integration: the error is not integrated while the output
+ *        is saturated in the direction of the error. The derivative can be taken on the measurement instead
+ *        of the error to avoid the kick on the setpoint change.
+ */
+class PID {
+    public:
+        PID(int16_t out_min, int16_t out_max);
+
+        void setTunings(float kp, float ki, float kd);
+
+        void setDerivativeMode(PIDDerivativeMode mode) { _derivative_mode = mode; };
+        PIDDerivativeMode getDerivativeMode() { return _derivative_mode; };
+
+        // constant bias added to the output
+        void setBias(int16_t bias) { _bias = bias; };
+
+        // Calculate the regulator output
+        // @param error deviation of the measurement from the target, relative to the target, Q10
+        // @param measurement measurement relative to the target, Q10. Used for the derivative on measurement
+        // @param elapsed number of time steps since the previous call, the gains are defined per step
+        int16_t compute(int32_t error, int32_t measurement, uint16_t elapsed);
+
+        // clear the integral and derivative state
+        void reset();
+
+        // restart the derivative, e.g. when the regulated quantity or the target has changed.
+        // The integral is kept so the output continues without a bump.
+        void restartDerivative() { _initialized = false; };
+
+        int16_t getOutput() { return _output; };
+
+        // returns true if the last output hit one of the limits
+        bool isSaturated() { return _output <= _out_min || _output >= _out_max; };
+
+    private:
+        int32_t _kp, _ki, _kd;
+
+        // integral term in the output units, Q26 (Q10 of the output and Q16 of Ki)
+        int64_t _integral;
+
+        // integral term in the output units, Q10
+        int32_t integral() { return (int32_t)( _integral >> PID_KI_SHIFT ); };
+
+        int32_t _last_error;
+        int32_t _last_measurement;
+        bool _initialized;
+
+        int16_t _out_min, _out_max;
+        int16_t _bias;
+        int16_t _output;
+
+        PIDDerivativeMode _derivative_mode;
+};
+
+#endif
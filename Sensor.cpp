@@ -56,11 +56,20 @@ void Sensor::reset() {
 
 void Sensor::print() {
     if(!_stream) return;      
-    ex_printf_to_stream(_stream, "%.5f %.5f %f %i",
-        _param[SENSOR_PARAM_OFFSET], 
-        _param[SENSOR_PARAM_SCALE],
-        _avg_reading, 
-        _last_reading);
+
+    // the sensor is sampled in the timer interrupt
+    float avg_reading;
+    int last_reading;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        avg_reading = _avg_reading;
+        last_reading = _last_reading;
+    }
+
+    ex_format(_stream,
+        ex_fixed<0,5>(_param[SENSOR_PARAM_OFFSET]), ' ',
+        ex_fixed<0,5>(_param[SENSOR_PARAM_SCALE]), ' ',
+        avg_reading, ' ',
+        last_reading);
 }
 
 SimpleSensor::SimpleSensor(int pin, float offset,  float scale, uint8_t num_samples, uint8_t sampling_period , uint8_t sampling_phase) :
@@ -88,8 +97,10 @@ void SimpleSensor::dump() {
     if(!_stream) return;
 
     for(int i=0; i < _num_samples; i++) {
+        int reading;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { reading = *(_readings+i); }
         if(i) _stream->write(',');
-        _stream->print(*(_readings+i)); 
+        _stream->print(reading); 
     }
 }
 
@@ -305,46 +316,56 @@ void SensorManager::sample() {
         _sensors[i]->sample();
 }
 
-void SensorManager::saveParams() {
-    long addr = _settings->getAddr(SETTINGS_SENSORS);
+static_assert( MAX_NUM_SENSORS * SENSOR_NUMPARAMS * sizeof(float) <= SETTINGS_BLOCK_SIZE[SETTINGS_SENSORS], "Sensor params do not fit the settings block" );
 
-    EEPROM.put(addr, _num_sensors);
-    addr += sizeof(int);
+void SensorManager::saveParams() {
+    int addr = _settings->create(SETTINGS_SENSORS);
+    int start = addr;
 
     for(uint8_t i=0; i < _num_sensors; i++ ) {
         for( uint8_t p = 0; p < SENSOR_NUMPARAMS; p++ ) {
-            EEPROM.put(addr, _sensors[i]->getParam(p));
+            EEPROM.put(addr, _sensors[i]->getParam((SensorParam) p));
             addr += sizeof(float);
         }
     }
 
-    _settings->updateSize( SETTINGS_SENSORS, addr - _settings->getAddr(SETTINGS_SENSORS) );
+    _settings->commit( SETTINGS_SENSORS, addr - start );
 }
 
 void SensorManager::loadParams() {
 
-    long addr = _settings->getAddr(SETTINGS_SENSORS);
-
-    int num_sensors = 0;
-    EEPROM.get(addr, num_sensors);
+    int addr = _settings->open(SETTINGS_SENSORS);
 
-    if( num_sensors != _num_sensors) {
+    if( addr < 0 || _settings->getSize(SETTINGS_SENSORS) != _num_sensors * SENSOR_NUMPARAMS * sizeof(float) ) {
+        // the params of the older firmware are migrated, the defaults are saved otherwise
+        if( _settings->isLegacy() ) load_legacy();
         saveParams();
         return;
     }
 
-    addr += sizeof(int);
+    read_params(addr);
+}
+
+void SensorManager::load_legacy() {
+    int addr = _settings->getLegacyAddr(SETTINGS_SENSORS);
+
+    // the number of sensors was saved as a byte followed by a spare one
+    uint8_t num_sensors = 0;
+    EEPROM.get(addr, num_sensors);
+
+    _settings->updateLegacySize( SETTINGS_SENSORS, sizeof(int) + _num_sensors * SENSOR_NUMPARAMS * sizeof(float) );
 
+    if( num_sensors == _num_sensors ) read_params(addr + sizeof(int));
+}
+
+void SensorManager::read_params(int addr) {
     float value;
     for(int i=0; i < _num_sensors; i++ ) {
         for( int p = 0; p < SENSOR_NUMPARAMS; p++ ) {
             value = 0;
             EEPROM.get(addr, value);
-            _sensors[i]->setParam( value, p);
+            _sensors[i]->setParam( value, (SensorParam) p);
             addr += sizeof(float);
         }   
     }
-
-    _settings->updateSize( SETTINGS_SENSORS, addr - _settings->getAddr(SETTINGS_SENSORS) );
-
 }
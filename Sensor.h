@@ -2,6 +2,7 @@
 #define Sensor_h
 
 #include  "config.h"
+#include <util/atomic.h>
 #include "utilities.h"
 #include "Settings.h"
 
@@ -52,13 +53,18 @@ class Sensor {
 
         virtual void reset();
 
-        float reading(){ return _avg_reading; };
+        // reading may be computed in the timer interrupt, so the loop gets a copy taken with the interrupts off
+        float reading(){ 
+            float value;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { value = _avg_reading; }
+            return value; 
+        };
 
         // triggered on the readings counter overflow
         virtual void on_counter_overflow(){;};
 
         // accumulate reading in the _reading sum
-        virtual void increment_sum(int reading){;};
+        virtual void increment_sum(int){;};
 
         // Compute the reading of the sensor, converted to measurement units (offset/scale applied).
         virtual void compute_reading(){;};
@@ -71,6 +77,9 @@ class Sensor {
 
         void clear_ready() { _ready = false; };
 
+        // number of ticks needed to take all the samples of the averaging window
+        unsigned int get_window() { return (unsigned int) _num_samples * _sampling_period; };
+
         virtual void dump() {;};
 
         // print sensor parameters
@@ -298,6 +307,11 @@ class SensorManager {
 
         bool _active;
 
+        // migrate the params saved by the older firmware
+        void load_legacy();
+
+        void read_params(int addr);
+
 };
 
 #endif
\ No newline at end of file
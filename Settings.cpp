@@ -0,0 +1,88 @@
+#include "Settings.h"
+
+void Settings::begin() {
+    for( uint8_t b = 0; b < SETTINGS_NUMBLOCKS; b++ ) {
+        _addr[b] = -1;
+        _legacy_size[b] = 0;
+    }
+
+    uint16_t magic = 0;
+    EEPROM.get(SETTINGS_BASE, magic);
+    _legacy = ( magic != SETTINGS_MAGIC );
+}
+
+void Settings::migrated() {
+    if( !_legacy ) return;
+
+    EEPROM.put(SETTINGS_BASE, (uint16_t) SETTINGS_MAGIC);
+    _legacy = false;
+}
+
+int Settings::open( SettingsBlock block ) {
+    _addr[block] = -1;
+
+    for( uint8_t slot = 0; slot < SETTINGS_NUMSLOTS; slot++ ) {
+        int addr = settings_slot_addr(block, slot);
+
+        SettingsHeader header;
+        EEPROM.get(addr, header);
+
+        if( header.version != SETTINGS_VERSION || header.size > SETTINGS_BLOCK_SIZE[block] ) continue;
+        if( crc(addr, &header) != header.crc ) continue;
+
+        // the later write wins, the sequence wraps around
+        if( _addr[block] >= 0 && (int8_t)( header.seq - _seq[block] ) < 0 ) continue;
+
+        _addr[block] = addr + sizeof(SettingsHeader);
+        _seq[block] = header.seq;
+        _size[block] = header.size;
+    }
+
+    return _addr[block];
+}
+
+int Settings::create( SettingsBlock block ) {
+    return settings_slot_addr(block, next_slot(block)) + sizeof(SettingsHeader);
+}
+
+void Settings::commit( SettingsBlock block, uint8_t size ) {
+    int addr = settings_slot_addr(block, next_slot(block));
+
+    SettingsHeader header;
+    header.version = SETTINGS_VERSION;
+    header.seq = _addr[block] >= 0 ? _seq[block] + 1 : 0;
+    header.size = size;
+    header.crc = crc(addr, &header);
+
+    // the header is written last, till then the previous slot stays active
+    EEPROM.put(addr, header);
+
+    _addr[block] = addr + sizeof(SettingsHeader);
+    _seq[block] = header.seq;
+    _size[block] = size;
+}
+
+int Settings::getLegacyAddr( SettingsBlock index ) {
+    int addr = 0;
+    for( uint8_t b = 0; b < index; b++ ) 
+        addr += _legacy_size[b];
+    return addr;
+}
+
+uint8_t Settings::next_slot( SettingsBlock block ) {
+    return ( _addr[block] == settings_slot_addr(block, 0) + (int) sizeof(SettingsHeader) ) ? 1 : 0;
+}
+
+uint16_t Settings::crc( int addr, SettingsHeader* header ) {
+    uint16_t crc = 0xFFFF;
+
+    crc = _crc16_update(crc, header->version);
+    crc = _crc16_update(crc, header->seq);
+    crc = _crc16_update(crc, header->size);
+
+    addr += sizeof(SettingsHeader);
+    for( uint8_t i = 0; i < header->size; i++ ) 
+        crc = _crc16_update(crc, EEPROM.read(addr + i));
+
+    return crc;
+}
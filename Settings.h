@@ -1,30 +1,95 @@
 #ifndef Settings_h
 #define Settings_h
 
+#include <Arduino.h>
+#include <util/crc16.h>
+
 #include "EEPROM.h"
 
+#define SETTINGS_BASE       0x100       // start of the store, the layout of the older firmware below is migrated
+#define SETTINGS_MAGIC      0x5355      // marks the formatted store
+#define SETTINGS_VERSION    1           // schema version of the blocks, the blocks of another version are not loaded
+#define SETTINGS_NUMSLOTS   2           // each block is written to the slots in turn
+
 enum SettingsBlock {
     SETTINGS_SENSORS,
     SETTINGS_CHARGER,
+    SETTINGS_PROFILE,
+    SETTINGS_ESTIMATOR,
+    SETTINGS_PROTOCOL,
     SETTINGS_NUMBLOCKS
 };
 
+// payload bytes reserved for each block, checked by the modules at compile time
+constexpr uint8_t SETTINGS_BLOCK_SIZE[SETTINGS_NUMBLOCKS] = { 40, 24, 80, 8, 2 };
+
+struct __attribute__((packed)) SettingsHeader {
+    uint8_t version;    // SETTINGS_VERSION
+    uint8_t seq;        // incremented on every write, the slot with the later one is active
+    uint8_t size;       // payload size
+    uint16_t crc;       // CRC16 of the fields above and the payload
+};
+
+// compile time layout: the magic, then the slots of the blocks in the order of SettingsBlock
+constexpr int settings_slot_size(uint8_t block) { 
+    return sizeof(SettingsHeader) + SETTINGS_BLOCK_SIZE[block]; 
+}
+
+constexpr int settings_block_addr(uint8_t block) {
+    return block ? settings_block_addr(block - 1) + SETTINGS_NUMSLOTS * settings_slot_size(block - 1) : SETTINGS_BASE + sizeof(uint16_t);
+}
+
+constexpr int settings_slot_addr(uint8_t block, uint8_t slot) { 
+    return settings_block_addr(block) + slot * settings_slot_size(block); 
+}
+
+#define SETTINGS_END settings_block_addr(SETTINGS_NUMBLOCKS)
 
+static_assert( SETTINGS_END <= E2END + 1, "Settings do not fit the EEPROM" );
+
+/**
+ * @brief Settings is the store of the params in EEPROM. Each block is kept in 2 slots with the header holding
+ *        the schema version, the write sequence and the CRC. A block is written to the inactive slot and then
+ *        sealed by its header, so the half written block is never loaded and the previous one stays valid.
+ *        The slots take the writes in turn, which halves the wear.
+ */
 class Settings {
     public:
-        long getAddr( SettingsBlock index ) {
-            long addr = 0;
-            for(int b=0; b < SETTINGS_NUMBLOCKS; b++ ) {
-                if( b == index ) return addr;
-                addr += _blocksize[b];
-            }
-            return addr;
-        };
+        // check whether the store is formatted, call before loading the blocks
+        void begin();
+
+        // finds the valid slot of the block, returns the address of its payload or -1 if there is none
+        int open( SettingsBlock block );
+
+        // address of the payload loaded by open(), -1 if the block is not valid
+        int getAddr( SettingsBlock block ) { return _addr[block]; };
+        uint8_t getSize( SettingsBlock block ) { return _size[block]; };
+
+        // address of the payload to be written. The block is sealed by commit() after the payload is written
+        int create( SettingsBlock block );
+        void commit( SettingsBlock block, uint8_t size );
 
-        void updateSize( SettingsBlock index, long bsize ) { _blocksize[index] = bsize; };
+        // migration from the layout of the older firmware, where the blocks were following each other from 0.
+        // The modules load their old block if the store is not formatted and report its size
+        bool isLegacy() { return _legacy; };
+        int getLegacyAddr( SettingsBlock index );
+        void updateLegacySize( SettingsBlock index, int bsize ) { _legacy_size[index] = bsize; };
+
+        // formats the store once the old blocks are migrated, call after loading the blocks
+        void migrated();
 
     private:
-        long _blocksize[ SETTINGS_NUMBLOCKS ];
+        int _addr[SETTINGS_NUMBLOCKS];
+        uint8_t _seq[SETTINGS_NUMBLOCKS];
+        uint8_t _size[SETTINGS_NUMBLOCKS];
+
+        bool _legacy = false;
+        int _legacy_size[SETTINGS_NUMBLOCKS];
+
+        // slot to be written next
+        uint8_t next_slot( SettingsBlock block );
+
+        uint16_t crc( int addr, SettingsHeader* header );
 };
 
 #endif
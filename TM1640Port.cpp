@@ -0,0 +1,71 @@
+#include "TM1640Port.h"
+
+#ifdef DISPLAY_TYPE_LED_TM1640
+
+// half period of the clock
+#define TM1640_DELAY()  _delay_us(0.5)
+
+void TM1640Port::begin() {
+    // the lines are high when idle
+    PORTB |= _BV(TM1640_DATA_BIT);
+    PORTB |= _BV(TM1640_CLOCK_BIT);
+    DDRB |= _BV(TM1640_DATA_BIT);
+    DDRB |= _BV(TM1640_CLOCK_BIT);
+
+    sendCommand(TM1640_CMD_DATA_FIXED);
+    for( uint8_t grid = 0; grid < TM1640_NUM_GRIDS; grid++ ) 
+        sendGrid(grid, 0);
+}
+
+void TM1640Port::setupDisplay(bool active, uint8_t intensity) {
+    sendCommand( TM1640_CMD_DISPLAY | ( active ? TM1640_DISPLAY_ON : 0 ) | min( intensity, TM1640_MAX_INTENSITY ) );
+}
+
+void TM1640Port::sendGrid(uint8_t grid, uint8_t data) {
+    start();
+    send(TM1640_CMD_ADDRESS | grid);
+    send(data);
+    stop();
+}
+
+void TM1640Port::sendCommand(uint8_t cmd) {
+    start();
+    send(cmd);
+    stop();
+}
+
+void TM1640Port::start() {
+    // the data falls while the clock is high
+    PORTB &= ~_BV(TM1640_DATA_BIT);
+    TM1640_DELAY();
+    PORTB &= ~_BV(TM1640_CLOCK_BIT);
+    TM1640_DELAY();
+}
+
+void TM1640Port::stop() {
+    // the data rises while the clock is high
+    PORTB &= ~_BV(TM1640_DATA_BIT);
+    TM1640_DELAY();
+    PORTB |= _BV(TM1640_CLOCK_BIT);
+    TM1640_DELAY();
+    PORTB |= _BV(TM1640_DATA_BIT);
+    TM1640_DELAY();
+}
+
+void TM1640Port::send(uint8_t data) {
+    // LSB first, the bit is latched by the rising edge of the clock
+    for( uint8_t i = 0; i < 8; i++ ) {
+        if( data & 0x01 ) 
+            PORTB |= _BV(TM1640_DATA_BIT);
+        else 
+            PORTB &= ~_BV(TM1640_DATA_BIT);
+        data >>= 1;
+
+        TM1640_DELAY();
+        PORTB |= _BV(TM1640_CLOCK_BIT);
+        TM1640_DELAY();
+        PORTB &= ~_BV(TM1640_CLOCK_BIT);
+    }
+}
+
+#endif
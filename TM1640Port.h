@@ -0,0 +1,50 @@
+#ifndef TM1640Port_h
+#define TM1640Port_h
+
+#include "config.h"
+
+#ifdef DISPLAY_TYPE_LED_TM1640
+
+#include <Arduino.h>
+#include <util/delay.h>
+
+#define TM1640_CMD_DATA_FIXED   0x44    // data is written to the fixed address
+#define TM1640_CMD_DISPLAY      0x80    // display control: on bit and the intensity
+#define TM1640_CMD_ADDRESS      0xC0
+#define TM1640_DISPLAY_ON       0x08
+#define TM1640_MAX_INTENSITY    7
+#define TM1640_NUM_GRIDS        16
+
+// the pins are on the port B (pins 8-13), so they are switched by single sbi/cbi instructions,
+// which do not race with the interrupts writing the other pins of the port
+#define TM1640_DATA_BIT         ( DISPLAY_DA_OUT - 8 )
+#define TM1640_CLOCK_BIT        ( DISPLAY_CLK_OUT - 8 )
+
+static_assert( DISPLAY_DA_OUT >= 8 && DISPLAY_DA_OUT <= 13 && DISPLAY_CLK_OUT >= 8 && DISPLAY_CLK_OUT <= 13, 
+               "TM1640 pins must be on the port B" );
+
+/**
+ * @brief TM1640Port is the driver of the TM1640 clocked by the direct writes to the port B at ~1MHz, which is 
+ *        the max clock of the chip. The grids are written by their address, so a single grid can be updated.
+ */
+class TM1640Port {
+    public:
+        // set up the pins and blank all the grids
+        void begin();
+
+        void setupDisplay(bool active, uint8_t intensity);
+
+        // write the segments of the grid, ~25us
+        void sendGrid(uint8_t grid, uint8_t data);
+
+    private:
+        void sendCommand(uint8_t cmd);
+
+        void start();
+        void stop();
+        void send(uint8_t data);
+};
+
+#endif
+
+#endif
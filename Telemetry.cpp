@@ -0,0 +1,43 @@
+#include "Telemetry.h"
+
+Telemetry::Telemetry(Print* stream, unsigned int window) {
+    _stream = stream;
+
+    // ms of the link taken by a record, 10 bits per byte with the start and stop bits
+    unsigned long record_ms = sizeof(TelemetryRecord) * 10000UL * TELEMETRY_LINK_SHARE / SERIAL_MONITOR_BAUD_RATE;
+    _min_period = window ? (uint8_t) constrain( ( record_ms + window - 1 ) / window, 1UL, 99UL ) : 1;
+}
+
+void Telemetry::subscribe(uint8_t windows) {
+    _period = ( windows && windows < _min_period ) ? _min_period : windows;
+    _counter = 0;
+}
+
+bool Telemetry::due() {
+    if( !_period ) return false;
+
+    if( ++_counter < _period ) return false;
+
+    _counter = 0;
+    return true;
+}
+
+void Telemetry::send(TelemetryRecord* record) {
+    record->sync = TELEMETRY_SYNC;
+    record->size = sizeof(TelemetryRecord);
+    record->seq = _seq++;
+    record->reserved = 0;
+
+    uint16_t crc = TELEMETRY_CRC_INIT;
+    const uint8_t* data = (const uint8_t*) record;
+    for( uint8_t i = 0; i < sizeof(TelemetryRecord) - sizeof(uint16_t); i++ ) 
+        crc = _crc_xmodem_update(crc, data[i]);
+    record->crc = crc;
+
+    if( _stream->availableForWrite() < (int) sizeof(TelemetryRecord) ) {
+        _dropped++;
+        return;
+    }
+
+    _stream->write(data, sizeof(TelemetryRecord));
+}
@@ -0,0 +1,46 @@
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include <Arduino.h>
+#include <Print.h>
+#include <util/crc16.h>
+
+#include "config.h"
+#include "TelemetryRecord.h"
+
+#define TELEMETRY_LINK_SHARE 4  // records take at most 1/N of the serial link, the rest is left to the responses
+
+/**
+ * @brief Telemetry is pushing binary records to the host subscribed by the B command, every N sensor
+ *        windows. The record is filled from the sensor readings as scaled integers, no text formatting.
+ *        A record is dropped if the output buffer has no room for it, so the loop is never blocked.
+ */
+class Telemetry {
+    public:
+        Telemetry(Print* stream, unsigned int window);
+
+        // push a record every windows sensor windows, 0 - unsubscribe. The period is raised to the minimum 
+        // fitting the link bandwidth
+        void subscribe(uint8_t windows);
+        bool isSubscribed() { return _period > 0; };
+
+        // call once per sensor window, returns true if the record is due
+        bool due();
+
+        // complete the header and the CRC and send the record
+        void send(TelemetryRecord* record);
+
+        uint16_t getDropped() { return _dropped; };
+        uint8_t getMinWindows() { return _min_period; };
+
+    private:
+        Print* _stream;
+
+        uint8_t _min_period;
+        uint8_t _period = 0;
+        uint8_t _counter = 0;
+        uint8_t _seq = 0;
+        uint16_t _dropped = 0;
+};
+
+#endif
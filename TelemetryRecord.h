@@ -0,0 +1,42 @@
+#ifndef TelemetryRecord_h
+#define TelemetryRecord_h
+
+#include <stdint.h>
+
+// This header is shared with the host decoder (extras/telemetry), so it must not depend on Arduino
+
+#define TELEMETRY_SYNC      0xA5    // first byte of the record
+#define TELEMETRY_CRC_INIT  0xFFFF
+
+/**
+ * @brief TelemetryRecord is a binary frame pushed to the subscribed host. Values are scaled integers,
+ *        little endian. The CRC is CRC-16/CCITT-FALSE (polynomial 0x1021, not reflected, starting from
+ *        TELEMETRY_CRC_INIT = 0xFFFF, no final XOR) over all the previous bytes. The firmware computes it by 
+ *        _crc_xmodem_update(), which differs from CRC-16/XMODEM only by the initial value.
+ */
+struct __attribute__((packed)) TelemetryRecord {
+    uint8_t sync;               // TELEMETRY_SYNC
+    uint8_t size;               // size of the record, including the CRC
+    uint8_t seq;                // incremented with each record, gaps point at the dropped records
+    uint8_t charger_mode;       // ChargingStatus
+    uint16_t status;            // InteractiveStatusFlags
+    uint16_t input_vac;         // 0.1V
+    uint16_t output_vac;        // 0.1V
+    uint16_t output_freq;       // 0.01Hz
+    uint16_t output_ac;         // mA
+    uint16_t battery_v;         // mV
+    int16_t battery_c;          // mA
+    uint8_t battery_level;      // %
+    uint8_t reserved;
+    int16_t remaining_min;      // -1 if charging
+    uint16_t crc;
+};
+
+inline uint16_t telemetry_crc_update(uint16_t crc, uint8_t data) {
+    crc ^= (uint16_t) data << 8;
+    for( uint8_t i = 0; i < 8; i++ ) 
+        crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : crc << 1;
+    return crc;
+}
+
+#endif
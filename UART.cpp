@@ -0,0 +1,128 @@
+#include "UART.h"
+
+UART uart;
+
+void UART::begin(unsigned long baud) {
+    // UDRE interrupt is enabled when there is something to send
+    hal_uart_begin(baud);
+}
+
+int UART::available() {
+    return (uint8_t)( _rx_head - _rx_tail ) & ( UART_RX_BUFFER_SIZE - 1 );
+}
+
+int UART::peek() {
+    if( _rx_head == _rx_tail ) return -1;
+    return _rx_buf[_rx_tail];
+}
+
+int UART::read() {
+    if( _rx_head == _rx_tail ) return -1;
+
+    uint8_t ch = _rx_buf[_rx_tail];
+    _rx_tail = ( _rx_tail + 1 ) & ( UART_RX_BUFFER_SIZE - 1 );
+    return ch;
+}
+
+int UART::availableForWrite() {
+    // one slot is kept empty to tell the full buffer from the empty one
+    return UART_TX_BUFFER_SIZE - 1 - ( (uint8_t)( _tx_head - _tx_tail ) & ( UART_TX_BUFFER_SIZE - 1 ) );
+}
+
+void UART::flush() {
+    // TXC is never set if nothing was sent
+    if( !_written ) return;
+
+    while( _tx_head != _tx_tail || !hal_uart_tx_complete() ) {
+        // drain the buffer by polling if called with the interrupts disabled
+        if( !hal_interrupts_enabled() && hal_uart_tx_ready() ) 
+            tx_handler();
+    }
+}
+
+size_t UART::write(uint8_t ch) {
+    uint8_t next = ( _tx_head + 1 ) & ( UART_TX_BUFFER_SIZE - 1 );
+
+    while( next == _tx_tail ) {
+        // buffer is full. With the interrupts disabled the UDRE interrupt will not come, so poll for it
+        if( !hal_interrupts_enabled() && hal_uart_tx_ready() ) 
+            tx_handler();
+    }
+
+    _tx_buf[_tx_head] = ch;
+    _tx_head = next;
+    _written = true;
+
+    // the transmission is started (or continued) by the UDRE interrupt
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        hal_uart_start_tx();
+    }
+
+    return 1;
+}
+
+size_t UART::write(const uint8_t* buf, size_t size) {
+    size_t written = 0;
+
+    while( written < size ) {
+        uint8_t space = availableForWrite();
+
+        // full buffer is handled by the single byte write
+        if( !space ) {
+            write( buf[written++] );
+            continue;
+        }
+
+        uint8_t head = _tx_head;
+        uint16_t chunk = min( size - written, (size_t) space );
+        // copy up to the end of the ring, the rest goes on the next iteration
+        chunk = min( chunk, (uint16_t)( UART_TX_BUFFER_SIZE - head ) );
+
+        memcpy( _tx_buf + head, buf + written, chunk );
+        _tx_head = ( head + chunk ) & ( UART_TX_BUFFER_SIZE - 1 );
+        written += chunk;
+        _written = true;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            hal_uart_start_tx();
+        }
+    }
+
+    return written;
+}
+
+void UART::rx_handler() {
+    uint8_t ch = hal_uart_read();
+    uint8_t next = ( _rx_head + 1 ) & ( UART_RX_BUFFER_SIZE - 1 );
+
+    _rx_idle = 0;
+
+    // the byte is dropped on overflow
+    if( next != _rx_tail ) {
+        _rx_buf[_rx_head] = ch;
+        _rx_head = next;
+    }
+    else if( _rx_overruns < 0xFFFF ) 
+        _rx_overruns++;
+}
+
+void UART::tx_handler() {
+    if( _tx_head == _tx_tail ) {
+        hal_uart_stop_tx();
+        return;
+    }
+
+    hal_uart_write( _tx_buf[_tx_tail] );
+    _tx_tail = ( _tx_tail + 1 ) & ( UART_TX_BUFFER_SIZE - 1 );
+
+    if( _tx_head == _tx_tail ) 
+        hal_uart_stop_tx();
+}
+
+ISR(USART_RX_vect) {
+    uart.rx_handler();
+}
+
+ISR(USART_UDRE_vect) {
+    uart.tx_handler();
+}
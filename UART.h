@@ -0,0 +1,74 @@
+#ifndef UART_h
+#define UART_h
+
+#include <Arduino.h>
+#include <Stream.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "HAL.h"
+
+// buffer sizes must be a power of 2, up to 256
+#define UART_TX_BUFFER_SIZE 256
+#define UART_RX_BUFFER_SIZE 128     // holds the input waiting for the full command queue, see VOLTRONIC_QUEUE_SIZE
+
+/**
+ * @brief UART is an interrupt driven serial port replacing the Arduino Serial. The transmission is
+ *        buffered in a large ring drained by the UDRE interrupt, so a response costs only its formatting
+ *        time in the main loop. The free space is reported by availableForWrite() so that the protocol
+ *        can hold the next command back instead of blocking on the full buffer.
+ */
+class UART : public Stream {
+    public:
+        void begin(unsigned long baud);
+
+        virtual int available();
+        virtual int peek();
+        virtual int read();
+        virtual int availableForWrite();
+
+        // wait till the transmission is complete
+        virtual void flush();
+
+        // writes into the ring buffer. Only waits if the buffer is full.
+        virtual size_t write(uint8_t ch);
+
+        // copies the block into the ring buffer at once
+        virtual size_t write(const uint8_t* buf, size_t size);
+
+        using Print::write;
+
+        // bytes dropped by the receive interrupt on the full buffer, saturated at 0xFFFF
+        uint16_t getRxOverruns() {
+            uint16_t overruns;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { overruns = _rx_overruns; }
+            return overruns;
+        };
+
+        // milliseconds since the last received byte, saturated at 255. Used to find the end of a binary frame
+        uint8_t rx_idle() { return _rx_idle; };
+
+        // called by the 1ms timer interrupt
+        void tick() { if( _rx_idle < 0xFF ) _rx_idle++; };
+
+        // interrupt handlers
+        inline void rx_handler();
+        inline void tx_handler();
+
+    private:
+        volatile uint8_t _rx_head = 0;
+        volatile uint8_t _rx_tail = 0;
+        volatile uint8_t _tx_head = 0;
+        volatile uint8_t _tx_tail = 0;
+        volatile uint8_t _rx_idle = 0xFF;
+        volatile uint16_t _rx_overruns = 0;
+
+        bool _written = false;
+
+        uint8_t _rx_buf[UART_RX_BUFFER_SIZE];
+        uint8_t _tx_buf[UART_TX_BUFFER_SIZE];
+};
+
+extern UART uart;
+
+#endif
@@ -4,6 +4,7 @@
 #include "utilities.h"
 
 #include "avr/wdt.h"
+#include "HAL.h"
 #include "Settings.h"
 
 #include "SimpleTimer.h"
@@ -12,8 +13,13 @@
 #include "Display.h"
 #include "Interactive.h"
 #include "Charger.h"
+#include "Estimator.h"
 
 #include "Voltronic.h"
+#include "UART.h"
+#include "Telemetry.h"
+#include "Modbus.h"
+#include "Journal.h"
 
 Settings settings;
 
@@ -32,13 +38,25 @@ SimpleSensor v_bat(SENSOR_BAT_V_IN, 0.0F, 0.05298, 20, 5 ,3 );
 // Battery current +/- 29.9A
 SimpleSensor c_bat(SENSOR_BAT_C_IN, -37.61F, 0.07362F, 20, 5, 4 );    
 
-SensorManager sensor_manager(&settings, &Serial);
+SensorManager sensor_manager(&settings, &uart);
 
 // init the charger on DEFAULT_CHARGER_PWM_OUT pin
 Charger charger(&settings, &c_bat, &v_bat);
 void start_charging();
 SimpleTimer* delayed_charge = nullptr;
 
+// fixed rate slot of the charger regulation, called from the timer interrupt
+void regulate_charger();
+SimpleTimer* charger_timer = nullptr;
+
+// battery readings of the same charger slot, latched once per loop pass for the queries, the estimator and telemetry
+float battery_vdc = 0.0F;
+float battery_current = 0.0F;
+void latch_battery();
+
+// init the battery runtime estimator, updated once per battery current sensor window
+RuntimeEstimator estimator(&settings, c_bat.get_window());
+
 // init the beeper timer
 void beep_on();
 void beep_off();
@@ -50,6 +68,7 @@ Interactive lineups( &vac_in, &vac_out, &ac_out, &v_bat);
 void start_self_test();
 void stop_self_test();
 SimpleTimer* self_test = nullptr;
+volatile bool deep_self_test = false; // self-test runs till the battery is low
 
 #ifndef DISPLAY_TYPE_NONE
 // init Display module
@@ -58,8 +77,21 @@ void refresh_display();
 SimpleTimer* display_refresh_timer = nullptr;
 #endif
 
-Voltronic serial_protocol( &Serial );
+Voltronic serial_protocol( &settings, &uart );
+void update_protocol_params(); // refresh the params reported by the queries
+void execute_command(ExecuteCommand exec_command); // act on the command received by the protocol
+uint16_t grand_status(); // status bits reported by QGS
+
+Telemetry telemetry( &uart, vac_in.get_window() );
+void send_telemetry(); // push the binary record to the subscribed host
+unsigned long status_published = 0;
+
+// Modbus RTU slave, serves the port instead of the text protocol when selected by M2
+Modbus modbus( &uart, &serial_protocol, &sensor_manager, &charger );
+
 
+// log of the power events, kept in the EEPROM over resets
+Journal journal;
 
 void wakeup_ups(); // put the lineups in normal mode
 void shutdown_ups(); // put the lineups in shutdown mode
@@ -72,11 +104,11 @@ void setup() {
   wdt_disable();
   pinMode(RESET_PIN, INPUT_PULLUP);
 
-  Serial.begin(SERIAL_MONITOR_BAUD_RATE);
+  uart.begin(SERIAL_MONITOR_BAUD_RATE);
   
-  Serial.write(VOLTRONIC_PROMPT);
-  ex_print_str_to_stream( &Serial, PART_MODEL, true);
-  Serial.println();
+  uart.write(VOLTRONIC_PROMPT);
+  ex_print_str_to_stream( &uart, PART_MODEL, true);
+  uart.println();
 
   // register sensors
   sensor_manager.register_sensor(&vac_in);
@@ -85,9 +117,14 @@ void setup() {
   sensor_manager.register_sensor(&v_bat);
   sensor_manager.register_sensor(&c_bat);
   
-  // load params from EEPROM
+  // load params from EEPROM, the params of the older firmware are migrated in the order of the blocks
+  settings.begin();
   sensor_manager.loadParams();
   charger.loadParams();
+  estimator.loadParams();
+  serial_protocol.loadParams();
+  settings.migrated();
+  journal.begin();
 
   // create timers
   delayed_charge = timer_manager.create( 0,TIMER_ONE_SEC,false,nullptr,start_charging);
@@ -97,26 +134,10 @@ void setup() {
 #endif
   self_test = timer_manager.create(0, MIN_SELFTEST_DURATION * 60 * TIMER_ONE_SEC, false, start_self_test, stop_self_test);
   shutdown_timer = timer_manager.create();
+  charger_timer = timer_manager.create(CHARGER_REGULATE_PERIOD, 0, false, regulate_charger);
 
-  cli(); // stop interrupts
-
-  // Timer 0 1000Hz. Used for display refresh, blinker and sensor readings.
-  TCNT0 = 0;
-  TCCR0A = _BV(WGM00)|_BV(WGM01);            /* Fast PWM, pins not activated */
-  TCCR0B = _BV(WGM02)|_BV(CS01)|_BV(CS00);   /* Fast PWM, Prescaler = x64     */
-  OCR0A = 249;
-  TIMSK0 = _BV(OCIE0A);
-
-  // Timer 1 used for charging (15.6KHz)
-  TCCR1A = _BV(WGM10) | _BV(WGM11);  // 10bit
-  TCCR1B = _BV(WGM12) | _BV(CS10);   // x1 fast pwm
-
- // accelerate analogRead
-
-  ADCSRA |= _BV(ADPS2); 
-  ADCSRA &= ~_BV(ADPS1);
-  ADCSRA &= ~_BV(ADPS0);
-  sei(); // resume interrupts
+  // Timer 0 1000Hz used for display refresh, blinker and sensor readings, Timer 1 for charging (15.6KHz)
+  hal_begin_timers();
   
   pinMode(BUZZ_PIN, OUTPUT);
 
@@ -132,7 +153,9 @@ void setup() {
   beep_off();
 #endif
 
-  Serial.println(VOLTRONIC_PROMPT);
+  charger_timer->start();
+
+  uart.println(VOLTRONIC_PROMPT);
 
   wdt_enable(WDTO_2S);
 }
@@ -146,23 +169,50 @@ ISR(TIMER0_COMPA_vect) {
 
   // increment timers and call callback functions where applicable
   timer_manager.tick();
+
+  // silence on the serial line, ends the Modbus frame
+  uart.tick();
   
 }
 
 
 void loop() {
 
+  latch_battery();
+
   if( vac_in.ready() && vac_out.ready() && ac_out.ready() && v_bat.ready() && c_bat.ready() ) {
     
-    // calculate sensors
+    // calculate sensors. Battery sensors are calculated in the charger slot
     vac_in.compute_reading();
     vac_out.compute_reading();
     ac_out.compute_reading();
-    v_bat.compute_reading();
-    c_bat.compute_reading();
 
     RegulateStatus result = lineups.regulate(timer_manager.getTicks());
 
+    // the transitions are queued, the EEPROM is written by journal.service()
+    journal.update(lineups.getStatus(), timer_manager.getTicks(), vac_in.reading(), lineups.getBatteryLevel());
+
+    // update the remaining time on battery
+    estimator.update(battery_current, lineups.getBatteryLevel(), timer_manager.getTicks());
+
+    // deep discharge test is over once the battery is low
+    if( deep_self_test && bitRead(lineups.getStatus(), BATTERY_LOW) ) {
+      self_test->stop();
+    }
+
+    // publish the status for the serial queries once per sensor window
+    if( timer_manager.getTicks() - status_published >= vac_in.get_window() ) {
+      status_published = timer_manager.getTicks();
+      update_protocol_params();
+
+      if( telemetry.due() ) send_telemetry();
+    }
+
+#ifndef DISPLAY_TYPE_NONE
+    // the display is redrawn only if the values it shows are changed
+    display.update();
+#endif
+
     switch(result) {
 
       case REGULATE_STATUS_FAIL:
@@ -211,14 +261,10 @@ void loop() {
           lineups.toggleOutput(true);
         }
 
-        if( !charger.is_charging() && !delayed_charge->isEnabled() && ( charger.get_mode() <= CHARGING_COMPLETE ) ) {
+        if( !charger.is_charging() && !delayed_charge->isEnabled() && ( charger.get_mode() <= CHARGING_COMPLETE || charger.get_mode() == CHARGING_AUTOTUNE_FAILED ) ) {
           delayed_charge->start( 0, 3 * TIMER_ONE_SEC );          
         }
 
-        // sensor_manager.suspend();
-        charger.regulate(timer_manager.getTicks());
-        // sensor_manager.resume();
-
         break;
 
       case REGULATE_STATUS_ERROR:
@@ -319,157 +365,259 @@ void loop() {
 
     }
 
-    if( serial_protocol.process() == '\r' ) {
-
-      serial_protocol.setParam(PARAM_INPUT_VAC, vac_in.reading());
-      serial_protocol.setParam(PARAM_INPUT_FAULT_VAC,lineups.getLastFaultInputVoltage());
-      serial_protocol.setParam(PARAM_OUTPUT_VAC, vac_out.reading());
-      serial_protocol.setParam(PARAM_OUTPUT_LOAD_LEVEL, ac_out.reading() / INTERACTIVE_MAX_AC_OUT );
-      serial_protocol.setParam(PARAM_BATTERY_LEVEL, lineups.getBatteryLevel() );
-      serial_protocol.setParam(PARAM_OUTPUT_FREQ, vac_out.get_frequency() );
-
-      // Estimate remaining battery time in minutes
-      if (c_bat.reading() <= 0) { // Discharge mode 
-        float remaining_capacity = lineups.getBatteryLevel() * INTERACTIVE_TOTAL_BATTERY_CAP; // Approximate remaining capacity in Ah
-        float discharge_rate = -c_bat.reading(); // Convert to positive value
-        // Time in minutes
-        serial_protocol.setParam( PARAM_REMAINING_MIN, min(discharge_rate > 0? (remaining_capacity / discharge_rate) * 60.0F : 0 , 999.0) ); 
-      } else {
-        // Charging mode
-        serial_protocol.setParam(PARAM_REMAINING_MIN, -1); 
-      }
-      
-      // serial_protocol.setParam(PARAM_REMAINING_MIN,0);
+  }
 
-      serial_protocol.setParam(PARAM_BATTERY_VDC, v_bat.reading());
-      serial_protocol.setParam(PARAM_INTERNAL_TEMP, 25.0); //TODO: replace with sensor reading
-      serial_protocol.setStatus(lowByte(lineups.getStatus()));
+#ifndef DISPLAY_TYPE_NONE
+  // the display frame is sent by a few bytes per pass, so the regulation is not delayed by the display bus
+  display.refresh();
+#endif
 
-      ExecuteCommand exec_command = serial_protocol.executeCommand();
+  // serial input is drained every pass, regardless of the sensors state
+  if( serial_protocol.getDialect() == DIALECT_MODBUS ) {
+    execute_command( modbus.process() );
+  }
+  else {
+    serial_protocol.process();
 
-      switch(exec_command) {
-        case COMMAND_BEEPER_MUTE:
-          lineups.toggleBeeper();
-          break;
-        case COMMAND_SELF_TEST:
-          if(!lineups.isBatteryMode() && lineups.getBatteryLevel() >= SELF_TEST_MIN_BAT_LVL && !self_test->isEnabled()) {
-            self_test->start(0, serial_protocol.getParam(PARAM_SELFTEST_MIN) * 60 * TIMER_ONE_SEC );
-          }
-          break;
-        case COMMAND_SELF_TEST_CANCEL:
-          self_test->stop();
-          break;
-        case COMMAND_SHUTDOWN:
-          // shutdown command received, we need to set the Interactive in shutdown mode either immediately or after the delay,
-          // depending on the shutdown time parameter
-          if( serial_protocol.getParam(PARAM_SHUTDOWN_MIN) == 0.0F ) {
-            shutdown_ups();
-          }
-          else if(! shutdown_timer->isEnabled() ) {
-            shutdown_timer->setOnFinish( shutdown_ups );
-            shutdown_timer->start( 0, (int) ( serial_protocol.getParam(PARAM_SHUTDOWN_MIN) * 60 * TIMER_ONE_SEC ) );
-          }
-          break;
-        case COMMAND_SHUTDOWN_CANCEL:
-          // shutdown cancel command received, we need to stop the shutdown timer
-          // and wake up the Interactive if it was in shutdown mode
-          if(shutdown_timer->isEnabled()) {
-            shutdown_timer->setOnFinish(nullptr);
-            shutdown_timer->stop();
-          }
-          
-          if(lineups.readStatus(SHUTDOWN_ACTIVE)) {
-            wakeup_ups();
-          }
+    // the commands queued from a line are executed back to back, so their responses go out in one burst
+    while( serial_protocol.commandReady() ) 
+      execute_command( serial_protocol.executeCommand() );
+  }
+
+  charger.service();
 
-          break;
+  journal.service();
+
+  wdt_reset();
+
+}
+
+void execute_command(ExecuteCommand exec_command) {
+  switch(exec_command) {
+    case COMMAND_BEEPER_MUTE:
+      lineups.toggleBeeper();
+      break;
+    case COMMAND_SELF_TEST:
+      if(!lineups.isBatteryMode() && lineups.getBatteryLevel() >= SELF_TEST_MIN_BAT_LVL && !self_test->isEnabled()) {
+        self_test->start(0, serial_protocol.getParam(PARAM_SELFTEST_MIN) * 60 * TIMER_ONE_SEC );
+      }
+      break;
+    case COMMAND_DEEP_TEST:
+      if(!lineups.isBatteryMode() && lineups.getBatteryLevel() >= SELF_TEST_MIN_BAT_LVL && !self_test->isEnabled()) {
+        deep_self_test = true;
+        self_test->start(0, (unsigned long) SELF_TEST_DEEP_MAX_MIN * 60 * TIMER_ONE_SEC );
+      }
+      break;
+    case COMMAND_SUBSCRIBE:
+      telemetry.subscribe( (uint8_t) serial_protocol.getParam(PARAM_TELEMETRY_WINDOWS) );
+      break;
+    case COMMAND_SELECT_DIALECT:
+      // the binary records would break the Modbus frames
+      if( serial_protocol.getDialect() == DIALECT_MODBUS ) telemetry.subscribe(0);
+      serial_protocol.saveParams();
+      break;
+    case COMMAND_READ_JOURNAL:
+      journal.print(&uart, (uint8_t) serial_protocol.getParam(PARAM_JOURNAL_PAGE));
+      break;
+    case COMMAND_READ_ERRORS:
+      ex_format(&uart, '#', ex_int<5>(uart.getRxOverruns()), ' ', ex_int<5>(telemetry.getDropped()), "\r\n");
+      break;
+    case COMMAND_SELF_TEST_CANCEL:
+      self_test->stop();
+      break;
+    case COMMAND_SHUTDOWN:
+      // shutdown command received, we need to set the Interactive in shutdown mode either immediately or after the delay,
+      // depending on the shutdown time parameter
+      if( serial_protocol.getParam(PARAM_SHUTDOWN_MIN) == 0.0F ) {
+        shutdown_ups();
+      }
+      else if(! shutdown_timer->isEnabled() ) {
+        shutdown_timer->setOnFinish( shutdown_ups );
+        shutdown_timer->start( 0, (int) ( serial_protocol.getParam(PARAM_SHUTDOWN_MIN) * 60 * TIMER_ONE_SEC ) );
+      }
+      break;
+    case COMMAND_SHUTDOWN_CANCEL:
+      // shutdown cancel command received, we need to stop the shutdown timer
+      // and wake up the Interactive if it was in shutdown mode
+      if(shutdown_timer->isEnabled()) {
+        shutdown_timer->setOnFinish(nullptr);
+        shutdown_timer->stop();
+      }
+      
+      if(lineups.readStatus(SHUTDOWN_ACTIVE)) {
+        wakeup_ups();
+      }
+
+      break;
 
 #ifndef DISPLAY_TYPE_NONE          
-        case COMMAND_SET_BRIGHTNESS:
-          display.set_brightness( (int)serial_protocol.getParam(PARAM_DISPLAY_BRIGHTNESS_LEVEL) );
-          break;
-        
-        case COMMAND_TOGGLE_DISPLAY:
-          display.toggle();
-          break;
-        
-        case COMMAND_TOGGLE_DISPLAY_MODE:
-          display.toggle_display_mode();
-          break;
+    case COMMAND_SET_BRIGHTNESS:
+      display.set_brightness( (int)serial_protocol.getParam(PARAM_DISPLAY_BRIGHTNESS_LEVEL) );
+      break;
+    
+    case COMMAND_TOGGLE_DISPLAY:
+      display.toggle();
+      break;
+    
+    case COMMAND_TOGGLE_DISPLAY_MODE:
+      display.toggle_display_mode();
+      break;
 #endif        
-        case COMMAND_READ_SENSOR:
-          if( serial_protocol.getSensorPtr() < sensor_manager.get_num_sensors() ) {
-            sensor_manager.print(serial_protocol.getSensorPtr());
-          }
-          else if(serial_protocol.getSensorPtr() == sensor_manager.get_num_sensors()) {
-            ex_printf_to_stream(&Serial, "#%i %i %f %f %f %f %f %i\r\n",
-                                              charger.is_charging(),
-                                              charger.get_mode(),
-                                              charger.get_current(),                                             
-                                              charger.get_voltage(),
-                                              c_bat.reading(),
-                                              v_bat.reading(),
-                                              charger.get_last_deviation(),
-                                              charger.get_output());
-          }
-          break;
-        case COMMAND_DUMP_SENSOR:
-          if( serial_protocol.getSensorPtr() < sensor_manager.get_num_sensors() ) {
-            sensor_manager.print(serial_protocol.getSensorPtr(), SENSOR_PRINT_DUMP );
-          }
-          break;
-        case COMMAND_TUNE_SENSOR:
-          if( serial_protocol.getSensorPtr() < sensor_manager.get_num_sensors() && 
-              serial_protocol.getSensorParam() < SENSOR_NUMPARAMS ) {
+    case COMMAND_READ_SENSOR:
+      if( serial_protocol.getSensorPtr() < sensor_manager.get_num_sensors() ) {
+        sensor_manager.print(serial_protocol.getSensorPtr());
+      }
+      else if(serial_protocol.getSensorPtr() == sensor_manager.get_num_sensors()) {
+        ex_format(&uart, '#', charger.is_charging(), ' ',
+                          charger.get_mode(), ' ',
+                          charger.get_current(), ' ',
+                          charger.get_voltage(), ' ',
+                          battery_current, ' ',
+                          battery_vdc, ' ',
+                          charger.get_last_deviation(), ' ',
+                          charger.get_output(), ' ',
+                          charger.get_jitter(), ' ',
+                          charger.get_profile(), ' ',
+                          charger.get_stage(), "\r\n");
+      }
+      break;
+    case COMMAND_DUMP_SENSOR:
+      if( serial_protocol.getSensorPtr() < sensor_manager.get_num_sensors() ) {
+        sensor_manager.print(serial_protocol.getSensorPtr(), SENSOR_PRINT_DUMP );
+      }
+      break;
+    case COMMAND_TUNE_SENSOR:
+      if( serial_protocol.getSensorPtr() < sensor_manager.get_num_sensors() && 
+          serial_protocol.getSensorParam() < SENSOR_NUMPARAMS ) {
+
+        Sensor* sensor = sensor_manager.get(serial_protocol.getSensorPtr());
+        // battery sensors are also computed in the charger slot
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+          sensor->setParam(serial_protocol.getSensorParamValue(), (SensorParam) serial_protocol.getSensorParam());
+          sensor->compute_reading();
+        }
+        sensor_manager.print(serial_protocol.getSensorPtr());
 
-            Sensor* sensor = sensor_manager.get(serial_protocol.getSensorPtr());
-            sensor->setParam(serial_protocol.getSensorParamValue(), serial_protocol.getSensorParam());
-            sensor->compute_reading();
-            sensor_manager.print(serial_protocol.getSensorPtr());
+      }
+      else if(serial_protocol.getSensorPtr() == sensor_manager.get_num_sensors()) {
+        charger.setParam(serial_protocol.getSensorParamValue(), (ChargerPIDParam) serial_protocol.getSensorParam());
+        ex_format(&uart, '(', charger.getParam(CHARGING_KP), ' ',
+                          charger.getParam(CHARGING_KI), ' ',
+                          charger.getParam(CHARGING_KD), ' ',
+                          charger.get_voltage(), ' ',
+                          charger.get_current(), ' ',
+                          battery_vdc, ' ',
+                          battery_current, ' ',
+                          charger.is_charging(), ' ',
+                          charger.get_mode(), ' ',
+                          charger.get_last_deviation(), ' ',
+                          charger.get_output(), "\r\n");
+      }
+      break;
+    
+    case COMMAND_AUTOTUNE_CHARGER:
+      // autotuning is only possible on mains with the load connected
+      if( serial_protocol.getSensorPtr() == sensor_manager.get_num_sensors() && 
+          !lineups.isBatteryMode() && lineups.readStatus(OUTPUT_CONNECTED) ) {
+        delayed_charge->stop();
+        charger.stop();
+        charger.set_min_battery_voltage(INTERACTIVE_MIN_V_BAT);        
+        charger.autotune( INTERACTIVE_BATTERY_AH * 0.1F, INTERACTIVE_MAX_V_BAT, timer_manager.getTicks());
+      }
+      break;
 
-          }
-          else if(serial_protocol.getSensorPtr() == sensor_manager.get_num_sensors()) {
-            charger.setParam(serial_protocol.getSensorParamValue(), serial_protocol.getSensorParam());
-            ex_printf_to_stream(&Serial, "(%f %f %f %f %f %f %f %i %i %f %i\r\n",
-                                        charger.getParam(CHARGING_KP),
-                                        charger.getParam(CHARGING_KI),
-                                        charger.getParam(CHARGING_KD),
-                                        charger.get_voltage(),
-                                        charger.get_current(),
-                                        v_bat.reading(),
-                                        c_bat.reading(),
-                                        charger.is_charging(),
-                                        charger.get_mode(),
-                                        charger.get_last_deviation(),
-                                        charger.get_output());
-          }
-          break;
-        
-        case COMMAND_SAVE_SENSORS:
-          sensor_manager.saveParams();
-          charger.saveParams();
-          break;
+    case COMMAND_SELECT_PROFILE:
+      if( serial_protocol.getSensorPtr() == sensor_manager.get_num_sensors() ) {
+        charger.set_profile(serial_protocol.getSensorParam());
+        charger.print_profile(&uart);
+      }
+      break;
 
-        default:
-          break;
+    case COMMAND_UPLOAD_PROFILE:
+      if( serial_protocol.getSensorPtr() == sensor_manager.get_num_sensors() ) {
+        charger.set_custom_stage(serial_protocol.getProfileStage(), 
+                                 serial_protocol.getSensorParam(), 
+                                 (int16_t) serial_protocol.getSensorParamValue());
+      }
+      // fall through - to print the profile
+    case COMMAND_PRINT_PROFILE:
+      if( serial_protocol.getSensorPtr() == sensor_manager.get_num_sensors() ) {
+        charger.print_profile(&uart);
       }
-    } 
+      break;
 
-#ifndef DISPLAY_TYPE_NONE
-    // refresh the display based on sensor readings, lineups and charger state
-    display.refresh();
-#endif
+    case COMMAND_SAVE_SENSORS:
+      sensor_manager.saveParams();
+      charger.saveParams();
+      break;
 
+    default:
+      break;
   }
+}
 
-  wdt_reset();
+void update_protocol_params() {
+  serial_protocol.setParam(PARAM_INPUT_VAC, vac_in.reading());
+  serial_protocol.setParam(PARAM_INPUT_FAULT_VAC,lineups.getLastFaultInputVoltage());
+  serial_protocol.setParam(PARAM_INPUT_FREQ, vac_in.get_frequency() );
+  serial_protocol.setParam(PARAM_OUTPUT_AC, ac_out.reading() );
+  serial_protocol.setParam(PARAM_OUTPUT_VAC, vac_out.reading());
+  serial_protocol.setParam(PARAM_OUTPUT_LOAD_LEVEL, ac_out.reading() / INTERACTIVE_MAX_AC_OUT );
+  serial_protocol.setParam(PARAM_BATTERY_LEVEL, lineups.getBatteryLevel() );
+  serial_protocol.setParam(PARAM_OUTPUT_FREQ, vac_out.get_frequency() );
+
+  // remaining battery time in minutes, cached by the estimator
+  serial_protocol.setParam(PARAM_REMAINING_MIN, estimator.get_remaining_minutes());
+
+  serial_protocol.setParam(PARAM_BATTERY_VDC, battery_vdc);
+  serial_protocol.setParam(PARAM_INTERNAL_TEMP, 25.0); //TODO: replace with sensor reading
+  serial_protocol.setStatus(lowByte(lineups.getStatus()));
+  serial_protocol.setGrandStatus(grand_status());
+
+  serial_protocol.publish();
+}
 
+void send_telemetry() {
+  TelemetryRecord record;
+
+  record.charger_mode = charger.get_mode();
+  record.status = lineups.getStatus();
+  record.input_vac = (uint16_t) round( vac_in.reading() * 10 );
+  record.output_vac = (uint16_t) round( vac_out.reading() * 10 );
+  record.output_freq = (uint16_t) round( vac_out.get_frequency() * 100 );
+  record.output_ac = (uint16_t) round( ac_out.reading() * 1000 );
+  record.battery_v = (uint16_t) round( battery_vdc * 1000 );
+  record.battery_c = (int16_t) round( battery_current * 1000 );
+  record.battery_level = (uint8_t) round( lineups.getBatteryLevel() * 100 );
+  record.remaining_min = (int16_t) estimator.get_remaining_minutes();
+
+  telemetry.send(&record);
+}
+
+uint16_t grand_status() {
+  uint16_t status = lineups.getStatus();
+  uint16_t result = 0;
+
+  bitWrite(result, GRAND_STATUS_INPUT_CONNECTED, bitRead(status, INPUT_CONNECTED));
+  bitWrite(result, GRAND_STATUS_OUTPUT_CONNECTED, bitRead(status, OUTPUT_CONNECTED));
+  bitWrite(result, GRAND_STATUS_OVERLOAD, bitRead(status, OVERLOAD));
+  bitWrite(result, GRAND_STATUS_BATTERY_DEAD, bitRead(status, BATTERY_DEAD));
+  bitWrite(result, GRAND_STATUS_BEEPER_ACTIVE, bitRead(status, BEEPER_IS_ACTIVE));
+  bitWrite(result, GRAND_STATUS_SHUTDOWN_ACTIVE, bitRead(status, SHUTDOWN_ACTIVE));
+  bitWrite(result, GRAND_STATUS_TEST, bitRead(status, SELF_TEST));
+  bitWrite(result, GRAND_STATUS_LINE_INTERACTIVE, bitRead(status, LINE_INTERACTIVE));
+  bitWrite(result, GRAND_STATUS_FAULT, bitRead(status, UPS_FAULT));
+  bitWrite(result, GRAND_STATUS_BOOST_BACK_ACTIVE, bitRead(status, REGULATED));
+  bitWrite(result, GRAND_STATUS_BATTERY_LOW, bitRead(status, BATTERY_LOW));
+  bitWrite(result, GRAND_STATUS_UTILITY_FAIL, bitRead(status, UTILITY_FAIL));
+
+  return result;
 }
 
 #ifndef DISPLAY_TYPE_NONE
-// initiate display refresh
+// blink and the heartbeat of the display
 void refresh_display() {
-  display.init_refresh();
+  display.heartbeat();
 }
 #endif
 
@@ -481,12 +629,27 @@ void beep_off() {
   digitalWrite(BUZZ_PIN, LOW);
 }
 
+// both readings are copied with the interrupts off, so they come from the same run of regulate_charger()
+void latch_battery() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    battery_vdc = v_bat.reading();
+    battery_current = c_bat.reading();
+  }
+}
+
+void regulate_charger() {
+  uint16_t latency = hal_tick_latency();
+
+  v_bat.compute_reading();
+  c_bat.compute_reading();
+  charger.regulate(timer_manager.getTicks(), latency);
+}
+
 void start_charging() {
   if( !lineups.readStatus(OUTPUT_CONNECTED) ) return;
 
   charger.set_min_battery_voltage(INTERACTIVE_MIN_V_BAT);        
-  charger.set_cutoff_current(INTERACTIVE_BATTERY_AH * 0.02F);
-  charger.start( INTERACTIVE_BATTERY_AH * 0.1F, INTERACTIVE_MAX_V_BAT, timer_manager.getTicks());
+  charger.start(timer_manager.getTicks());
 }
 
 void start_self_test() {
@@ -494,6 +657,7 @@ void start_self_test() {
 }
 
 void stop_self_test() {
+  deep_self_test = false;
   lineups.setSelfTestMode(false);
 }
 
@@ -1,8 +1,16 @@
 #include "Voltronic.h"
+#include "UART.h"
 
+// the input is left in the receive buffer while the queue is full, so it must hold the queue worth of commands
+static_assert( UART_RX_BUFFER_SIZE >= VOLTRONIC_QUEUE_SIZE * COMMAND_BUFFER_SIZE, "Receive buffer is smaller than the command queue" );
 
-Voltronic::Voltronic( Stream* stream) {
+static const CommandDialect* const DIALECTS[NUM_DIALECTS] = { &VOLTRONIC_DIALECT, &MEGATEC_DIALECT, &MODBUS_DIALECT };
+
+Voltronic::Voltronic( Settings* settings, Stream* stream) {
+    _settings = settings;
     _stream = stream;
+    _dialect = DIALECTS[DIALECT_VOLTRONIC];
+    _buf = _queue[0];
 
     _param[PARAM_SELFTEST_MIN] = MIN_SELFTEST_DURATION;
     _param[PARAM_OUTPUT_FREQ] = INTERACTIVE_DEFAULT_FREQ;
@@ -15,235 +23,216 @@ Voltronic::Voltronic( Stream* stream) {
     _param[PARAM_DISPLAY_BRIGHTNESS_LEVEL] = DISPLAY_DEFAULT_BRIGHTNESS;
 #endif
 
+    publish();
 }
 
-char Voltronic::process() {
+bool Voltronic::selectDialect(uint8_t dialect) {
+    if( dialect >= NUM_DIALECTS ) return false;
 
-    if(_stream->available() ) {
-        int ch = _stream->read();  
+    _dialect_index = dialect;
+    _dialect = DIALECTS[dialect];
+    return true;
+}
+
+void Voltronic::loadParams() {
+    int addr = _settings->open(SETTINGS_PROTOCOL);
+
+    uint8_t dialect = DIALECT_VOLTRONIC;
+    if( addr >= 0 ) 
+        EEPROM.get(addr, dialect);
+    else if( _settings->isLegacy() ) 
+        EEPROM.get(_settings->getLegacyAddr(SETTINGS_PROTOCOL), dialect);
+
+    // the blank EEPROM is reset to the default dialect
+    if( !selectDialect(dialect) ) {
+        selectDialect(DIALECT_VOLTRONIC);
+        addr = -1;
+    }
+
+    if( addr < 0 ) saveParams();
+}
+
+void Voltronic::saveParams() {
+    int addr = _settings->create(SETTINGS_PROTOCOL);
+
+    EEPROM.put( addr, _dialect_index );
+
+    _settings->commit( SETTINGS_PROTOCOL, sizeof(uint8_t) );
+}
+
+void Voltronic::publish() {
+
+    BufferPrint qs(_qs_response, VOLTRONIC_QS_SIZE);
+
+    ex_format(&qs, '(',
+        ex_fixed<4,1>(_param[PARAM_INPUT_VAC]), ' ',
+        ex_fixed<4,1>(_param[PARAM_INPUT_FAULT_VAC]), ' ',
+        ex_fixed<4,1>(_param[PARAM_OUTPUT_VAC]), ' ',
+        ex_int<3>(_param[PARAM_OUTPUT_LOAD_LEVEL] * 100), ' ',
+        ex_fixed<3,1>(_param[PARAM_OUTPUT_FREQ]), ' ',
+        ex_fixed<3,1>(_param[PARAM_BATTERY_VDC]), ' ',
+        ex_fixed<3,1>(_param[PARAM_INTERNAL_TEMP]), ' ',
+        ex_bin(_status), "\r\n"
+    );
+
+    BufferPrint qbv(_qbv_response, VOLTRONIC_QBV_SIZE);
+
+    ex_format(&qbv, '(',
+        ex_fixed<4,2>(_param[PARAM_BATTERY_VDC]), ' ',
+        ex_int<2>(INTERACTIVE_NUM_CELLS), ' ',
+        ex_int<2>(INTERACTIVE_NUM_BATTERY_PACKS), ' ',
+        (int) ( _param[PARAM_BATTERY_LEVEL] * 100 ), ' ',
+        ex_int<3>(_param[PARAM_REMAINING_MIN]), "\r\n"
+    );
+}
 
-        if(ch == '\r') {
-            _buf[_buf_ptr] = '\0';
-            return ch;
+void Voltronic::process() {
+
+    // the input is left unread while the queue is full
+    while( _queue_count < VOLTRONIC_QUEUE_SIZE && _stream->available() ) {
+        int ch = _stream->read();  
+        char* input = _queue[_queue_head];
+
+        // the dropped line is answered once by the empty command, which is not implemented
+        if( _discard ) {
+            if( ch != '\r' ) continue;
+            _discard = false;
+            _queue_head = ( _queue_head + 1 ) % VOLTRONIC_QUEUE_SIZE;
+            _queue_count++;
+            continue;
         }
-        else {
-            _buf[_buf_ptr] = (char)lowByte(ch);
+
+        // the commands of a line separated by ';' are queued one by one, empty ones are skipped
+        if( ch == '\r' || ch == VOLTRONIC_SEPARATOR ) {
+            if( !_input_ptr ) continue;
+
+            input[_input_ptr] = '\0';
+            _input_ptr = 0;
+            _queue_head = ( _queue_head + 1 ) % VOLTRONIC_QUEUE_SIZE;
+            _queue_count++;
+            continue;
         }
 
-        _buf_ptr++;
+        input[_input_ptr] = (char)lowByte(ch);
 
-        if( _buf_ptr >= COMMAND_BUFFER_SIZE ) 
-            _buf_ptr = 0;
-    }
+        _input_ptr++;
 
-    return '\0';    
+        // the last symbol is reserved for the terminator, too long input is dropped with the rest of its line,
+        // so its tail is not taken for a command
+        if( _input_ptr >= COMMAND_BUFFER_SIZE - 1 ) {
+            memset(input, 0x0, COMMAND_BUFFER_SIZE);
+            _input_ptr = 0;
+            _discard = true;
+        }
+    }
 }
 
 ExecuteCommand Voltronic::executeCommand() {
 
     int command_status = COMMAND_NONE;
+
+    if( !_queue_count ) return COMMAND_NONE;
+
+    _buf = _queue[_queue_tail];
     
+    // responses of other devices are ignored
     if( _buf[0] != '#' && _buf[0] != '(') {
 
-        switch(_buf[0]) {
-            case 'M':
-                _stream->write(VOLTRONIC_PROMPT); 
-                _stream->write(VOLTRONIC_DEFAULT_PROTOCOL); 
-                _stream->println();
-                break;
-            case 'Q':
-                if(_buf[1] == 'S') {
-
-                    ex_printf_to_stream(_stream, "(%4.1f %4.1f %4.1f %3i %3.1f %3.1f %3.1f %b\r\n",
-                        _param[PARAM_INPUT_VAC],
-                        _param[PARAM_INPUT_FAULT_VAC],
-                        _param[PARAM_OUTPUT_VAC],
-                        (int)(_param[PARAM_OUTPUT_LOAD_LEVEL] * 100),
-                        _param[PARAM_OUTPUT_FREQ],
-                        _param[PARAM_BATTERY_VDC],
-                        _param[PARAM_INTERNAL_TEMP],
-                        _status
-                    );
-
-                }
-                else if( _buf[1] == 'G' && _buf[2] == 'S' ) {
-                    // TODO: support Grand Status
-                    _stream->write(VOLTRONIC_PROMPT); 
-                    _stream->write(_buf, _buf_ptr);
-                    _stream->println();
-                }
-                else if( _buf[1] == 'R' && _buf[2] == 'I' ) {
-                    ex_printf_to_stream(_stream, "#%4.1f %3i %3.1f %3.1f\r\n", 
-                        _param[PARAM_OUTPUT_VAC_NOMINAL],
-                        (int)_param[PARAM_OUTPUT_AC_NOMINAL],
-                        _param[PARAM_BATTERY_VDC_NOMINAL],
-                        _param[PARAM_OUTPUT_FREQ_NOMINAL]
-                    );
-                }
-                else if( _buf[1] == 'M' && _buf[2] == 'D' ) {
-
-                    ex_printf_to_stream(_stream, "(%15S %7i %3.0f %3s %3.0f %3.0f %2i %3.1f\r\n",
-                        PART_NUMBER,
-                        RATED_VA,
-                        (float)100.0F * ACTUAL_VA / RATED_VA,
-                        "1/1",
-                        INTERACTIVE_DEFAULT_INPUT_VOLTAGE,
-                        _param[PARAM_OUTPUT_VAC_NOMINAL],
-                        INTERACTIVE_NUM_CELLS,
-                        INTERACTIVE_MAX_V_BAT_CELL
-                    );
-
-                }
-                else if( _buf[1] == 'M' && _buf[2] == 'F' ) {
-                    _stream->write('(');
-                    ex_print_str_to_stream(_stream, MANUFACTURER, true);
-                    _stream->println();
-                }
-                else if( _buf[1] == 'B' && _buf[2] == 'V' ) {
-
-                    ex_printf_to_stream(_stream, "(%4.2f %2i %2i %i %3i\r\n", 
-                        _param[PARAM_BATTERY_VDC],
-                        INTERACTIVE_NUM_CELLS,
-                        INTERACTIVE_NUM_BATTERY_PACKS,
-                        (int) ( _param[PARAM_BATTERY_LEVEL] * 100 ),
-                        (int)_param[PARAM_REMAINING_MIN]
-                    );
-
-                }
-                else {
-                    command_status = COMMAND_BEEPER_MUTE;
-                }
-                break;
- 
-#ifndef DISPLAY_TYPE_NONE            
-            case 'D':
-                // 'undocumented' case - change the display brightness
-                // format is DN where N is from 0 to 9 - sets the brightness level.
-                // 0 level means display is off
-                // if N is omitted the display will be switched on or off using max brightness as default
-                
-                if(isDigit(_buf[1])) {
-                    int lvl = (char)(_buf[1] - '0');
-                    if( lvl <= DISPLAY_MAX_BRIGHTNESS ) {
-                        _param[PARAM_DISPLAY_BRIGHTNESS_LEVEL] = lvl;
-                        command_status = COMMAND_SET_BRIGHTNESS;
-                    }   
-                }
-                else if (_buf[1] == 'M')
-                {
-                    command_status = COMMAND_TOGGLE_DISPLAY_MODE;
-                }
-                else {
-                    command_status = COMMAND_TOGGLE_DISPLAY;
-                }
-                
-                break;
-#endif            
-            case 'R':
-                // hard reset
-                pinMode(RESET_PIN, OUTPUT);
-                digitalWrite(RESET_PIN, LOW);
-                break;
-
-            case 'T':
-                command_status = COMMAND_SELF_TEST;
-                if(_buf[1] != 'L') {
-                    _param[PARAM_SELFTEST_MIN] = max( ex_parse_float(_buf, 1,2), MIN_SELFTEST_DURATION );
-                }
-                else {
-                    //TODO: deep discharge test
-                    ;
-                }
-                
-                break;
-            
-            case 'I':
-                
-                ex_printf_to_stream(_stream, "#%15S %10S %10S\r\n", 
-                    MANUFACTURER,
-                    PART_NUMBER,
-                    FIRMWARE_VERSION
-                );
-
-                break;
-
-            case 'S':
-
-                _param[PARAM_SHUTDOWN_MIN] = ex_parse_float(_buf, 1,2);
-
-                if(_buf[3] == 'R') 
-                    _param[PARAM_RESTORE_MIN] = ex_parse_float(_buf, 4,4);
-                else
-                    _param[PARAM_RESTORE_MIN] = 0;
-
-                if(_param[PARAM_SHUTDOWN_MIN] > 0)
-                    command_status = COMMAND_SHUTDOWN;
-
-                break;
-
-            case 'C':
-                switch(_buf[1]) {
-                    case 'T':
-                        command_status = COMMAND_SELF_TEST_CANCEL;
-                        break;
-                    case 'S':
-                    default:
-                        command_status = COMMAND_SHUTDOWN_CANCEL;
-                        break;
-                }
-                break;
-
-            case 'V':
-                // undocumented case - allows to tune or read sensors and charger params
-                // format: VNPMVKKKKKKKKKKKKKKKKK, where
-                // N - id of the sensor (0..4)
-                // M - can be 0 (scale) or 1 (offset). PM can be omitted - then sensor params are printed
-                // K - float value to be set (17 symbols). Can be omitted
-                
-                _sensor_ptr = (uint8_t) ex_parse_float(_buf, 1,1);
-                switch( _buf[2]) {
-                    case 'P':
-                        _sensor_param = (uint8_t) ex_parse_float(_buf, 3,1);
-
-                        if( _buf[4] == 'V' ) {
-                            _sensor_param_value = ex_parse_float(_buf, 5,17);
-                            command_status = COMMAND_TUNE_SENSOR;
-                        }
-                        else 
-                            command_status = COMMAND_READ_SENSOR;
-                        break;
-                    case 'D':
-                        command_status = COMMAND_DUMP_SENSOR;
-                        break;
-                    default:
-                        command_status = COMMAND_READ_SENSOR;
-                        break;
-
-                }
-
-                break;
-
-            case 'W':
-                // undocumented case - save sensor params to EEPROM
-                command_status = COMMAND_SAVE_SENSORS;
-                break;
-
-            default:
-                // Not implemented
-                _stream->write(VOLTRONIC_PROMPT); 
-                _stream->write('N');
-                _stream->println();
-                break;
+        CommandEntry entry;
 
+        if( find_command(&entry) ) {
+            command_status = entry.handler ? entry.handler(this, entry.result) : entry.result;
+        }
+        else {
+            // Not implemented
+            _stream->write(VOLTRONIC_PROMPT); 
+            _stream->write('N');
+            _stream->println();
         }
 
     }
 
-    // clear buffer
-    _buf_ptr=0;
+    // release the slot
     memset(_buf, 0x0, COMMAND_BUFFER_SIZE);
+    _queue_tail = ( _queue_tail + 1 ) % VOLTRONIC_QUEUE_SIZE;
+    _queue_count--;
+
+    return (ExecuteCommand) command_status;
+}
+
+bool Voltronic::find_command(CommandEntry* entry) {
+
+    uint8_t key_len = 0;
+    while( key_len < COMMAND_KEY_SIZE && _buf[key_len] >= 'A' && _buf[key_len] <= 'Z' ) 
+        key_len++;
+
+    char key[COMMAND_KEY_SIZE + 1];
+
+    // the longest key matching the input wins
+    for( ; key_len > 0; key_len-- ) {
+
+        memcpy(key, _buf, key_len);
+        key[key_len] = '\0';
+
+        // binary search of the first entry with the key
+        uint8_t lo = 0, hi = _dialect->size;
+        while( lo < hi ) {
+            uint8_t mid = ( lo + hi ) / 2;
+            memcpy_P(entry, &_dialect->table[mid], sizeof(CommandEntry));
+
+            if( strcmp(entry->key, key) < 0 ) 
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        // entries with the same key are tried in the table order
+        for( ; lo < _dialect->size; lo++ ) {
+            memcpy_P(entry, &_dialect->table[lo], sizeof(CommandEntry));
+
+            if( strcmp(entry->key, key) ) break;
+
+            if( parse_args(entry->pattern, key_len) ) return true;
+        }
+    }
+
+    return false;
+}
+
+bool Voltronic::parse_args(const char* pattern, uint8_t pos) {
+
+    bool optional = false;
+    _num_args = 0;
+
+    for( uint8_t p = 0; p < COMMAND_PATTERN_SIZE && pattern[p]; p++ ) {
+        char symbol = pattern[p];
+
+        if( symbol == ARG_OPTIONAL[0] ) {
+            optional = true;
+            continue;
+        }
+
+        // the optional part may be omitted as a whole
+        if( optional && _buf[pos] == '\0' ) return true;
+
+        uint8_t len = command_field_len(symbol);
+
+        if( !len ) {
+            if( _buf[pos] != symbol ) return false;
+            pos++;
+            continue;
+        }
+
+        ExFixedValue value;
+
+        if( _num_args >= COMMAND_MAX_ARGS || 
+            ex_parse_fixed(_buf, &pos, len, symbol == ARG_FLOAT[0], &value) != EX_PARSE_OK ) return false;
+
+        _args[_num_args++] = ex_fixed_to_float(value);
+    }
 
-    return command_status;
+    // the input after the pattern is ignored as by the former parser, the hosts send e.g. the variants of CS
+    return true;
 }
 
 
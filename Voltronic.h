@@ -3,8 +3,14 @@
 
 #define VOLTRONIC_RELEASE 2.0
 #define VOLTRONIC_DEFAULT_PROTOCOL  'V'
+#define MEGATEC_PROTOCOL            'Q'
+#define MODBUS_PROTOCOL             'R'
 
 #define COMMAND_BUFFER_SIZE 32
+#define VOLTRONIC_MIN_TX_SPACE 128  // free space in the output buffer required to execute the next command
+#define VOLTRONIC_QUEUE_SIZE 3      // max number of complete commands received ahead of the execution, the input waits when full
+#define VOLTRONIC_QS_SIZE 56        // buffer of the pre-rendered QS response
+#define VOLTRONIC_QBV_SIZE 32       // buffer of the pre-rendered QBV response
 #define DEFAULT_INTERNAL_TEMP 25.0
 
 #include <Stream.h>
@@ -12,8 +18,11 @@
 
 #include "config.h"
 #include "utilities.h"
+#include "CommandTable.h"
+#include "Settings.h"
 
 static const char VOLTRONIC_PROMPT = '#';
+static const char VOLTRONIC_SEPARATOR = ';';     // separates the commands sent in one line
 static const float MIN_SELFTEST_DURATION = 0.2F;
 
 enum StatusBit {
@@ -27,10 +36,28 @@ enum StatusBit {
     STATUS_UTILITY_FAIL 
 };
 
+// bits of the QGS status, b9..b0 a0 a1 as transmitted
+enum GrandStatusBit {
+    GRAND_STATUS_INPUT_CONNECTED,   // a1
+    GRAND_STATUS_OUTPUT_CONNECTED,  // a0
+    GRAND_STATUS_OVERLOAD,          // b0
+    GRAND_STATUS_BATTERY_DEAD,      // b1
+    GRAND_STATUS_BEEPER_ACTIVE,     // b2
+    GRAND_STATUS_SHUTDOWN_ACTIVE,   // b3
+    GRAND_STATUS_TEST,              // b4
+    GRAND_STATUS_LINE_INTERACTIVE,  // b5
+    GRAND_STATUS_FAULT,             // b6
+    GRAND_STATUS_BOOST_BACK_ACTIVE, // b7
+    GRAND_STATUS_BATTERY_LOW,       // b8
+    GRAND_STATUS_UTILITY_FAIL,      // b9
+    GRAND_STATUS_NUMBITS
+};
+
 enum ExecuteCommand {
     COMMAND_NONE,
     COMMAND_BEEPER_MUTE,
     COMMAND_SELF_TEST,
+    COMMAND_DEEP_TEST,
     COMMAND_SELF_TEST_CANCEL,
     COMMAND_SHUTDOWN,
     COMMAND_SHUTDOWN_CANCEL,
@@ -42,18 +69,28 @@ enum ExecuteCommand {
     COMMAND_READ_SENSOR,
     COMMAND_TUNE_SENSOR,
     COMMAND_SAVE_SENSORS,
-    COMMAND_DUMP_SENSOR
+    COMMAND_DUMP_SENSOR,
+    COMMAND_AUTOTUNE_CHARGER,
+    COMMAND_PRINT_PROFILE,
+    COMMAND_SELECT_PROFILE,
+    COMMAND_UPLOAD_PROFILE,
+    COMMAND_SUBSCRIBE,
+    COMMAND_SELECT_DIALECT,
+    COMMAND_READ_JOURNAL,
+    COMMAND_READ_ERRORS
 };
 
 enum VoltronicParam {
     PARAM_INPUT_VAC,
     PARAM_INPUT_FAULT_VAC,
+    PARAM_INPUT_FREQ,
     PARAM_OUTPUT_VAC,
     PARAM_OUTPUT_VAC_NOMINAL,
     PARAM_OUTPUT_AC_NOMINAL,
     PARAM_OUTPUT_FREQ,
     PARAM_OUTPUT_FREQ_NOMINAL,
     PARAM_OUTPUT_LOAD_LEVEL,
+    PARAM_OUTPUT_AC,            // output current, Amp
     PARAM_BATTERY_VDC,
     PARAM_BATTERY_VDC_NOMINAL,
     PARAM_BATTERY_LEVEL,
@@ -62,52 +99,133 @@ enum VoltronicParam {
     PARAM_SHUTDOWN_MIN,         // minutes till disconnect output
     PARAM_REMAINING_MIN,        // remaining time on battery in minutes
     PARAM_RESTORE_MIN,          // get the minutes till restore output
+    PARAM_TELEMETRY_WINDOWS,    // number of sensor windows between the telemetry records, 0 - off
+    PARAM_JOURNAL_PAGE,         // page of the power event journal requested by QJ
 #ifndef DISPLAY_TYPE_NONE
     PARAM_DISPLAY_BRIGHTNESS_LEVEL,
 #endif
     PARAM_NUMPARAM
 };
 
+// protocol dialects selected by the MN command
+enum ProtocolDialect {
+    DIALECT_VOLTRONIC,
+    DIALECT_MEGATEC,
+    DIALECT_MODBUS,
+    NUM_DIALECTS
+};
+
+// commands of the Voltronic protocol, see VoltronicCommands.cpp
+extern const CommandDialect VOLTRONIC_DIALECT;
+// commands of the Megatec (Q1) protocol, see MegatecCommands.cpp
+extern const CommandDialect MEGATEC_DIALECT;
+// Modbus RTU has no text commands, the port is served by the Modbus class, see Modbus.cpp
+extern const CommandDialect MODBUS_DIALECT;
+
 /**
- * @brief this class implements Voltronic protocol for serial communication with the UPS controller
+ * @brief this class implements Voltronic protocol for serial communication with the UPS controller.
+ *        Commands are looked up in the table of the dialect, which defines their arguments and handlers.
+ *        The dialect is selected at runtime and saved to EEPROM.
  * 
  */
 class Voltronic {
 
     public:
-        Voltronic(Stream* stream );
+        Voltronic(Settings* settings, Stream* stream);
 
-        // process input/output over the Serial interface
-        char process();
+        // switch to the ProtocolDialect, false if there is no such dialect
+        bool selectDialect(uint8_t dialect);
+        uint8_t getDialect() { return _dialect_index; };
+        char getProtocol() { return _dialect->protocol; };
 
+        void loadParams();
+        void saveParams();
+
+        // read all the available input and queue the complete commands
+        void process();
+
+        // true if a command is queued and the output has room for its response
+        bool commandReady() { return _queue_count && _stream->availableForWrite() >= VOLTRONIC_MIN_TX_SPACE; };
+
+        // execute the next command from the queue
         ExecuteCommand executeCommand();
 
         void setStatus( uint8_t status ) { _status = status; };
         uint8_t getStatus() { return _status; };
 
+        // extended status reported by QGS, see GrandStatusBit
+        void setGrandStatus( uint16_t status ) { _grand_status = status; };
+        uint16_t getGrandStatus() { return _grand_status; };
+
         float getParam(int index) { return _param[index];};
         void setParam(int index, float value) { _param[index] = value;};
 
+        // render the status responses from the current params, so the queries only copy them to the output
+        void publish();
+
+        const char* getStatusResponse() { return _qs_response; };
+        const char* getBatteryResponse() { return _qbv_response; };
+
         int getSensorPtr() { return _sensor_ptr; };
         float getSensorParamValue() { return _sensor_param_value; };
         int getSensorParam() { return _sensor_param; };
+        int getProfileStage() { return _profile_stage; };
+
+        // accessors for the command handlers
+        Stream* getStream() { return _stream; };
+        const char* getCommand() { return _buf; };
+        uint8_t getNumArgs() { return _num_args; };
+        float getArg(uint8_t index) { return index < _num_args ? _args[index] : 0.0F; };
+
+        void setSensorPtr(uint8_t ptr) { _sensor_ptr = ptr; };
+        void setSensorParam(uint8_t param) { _sensor_param = param; };
+        void setSensorParamValue(float value) { _sensor_param_value = value; };
+        void setProfileStage(uint8_t stage) { _profile_stage = stage; };
 
     private:
 
-        char _buf[COMMAND_BUFFER_SIZE];
-        uint8_t _buf_ptr = 0;
+        // queue of the received commands. The slot at the head is being filled by the input
+        char _queue[VOLTRONIC_QUEUE_SIZE][COMMAND_BUFFER_SIZE];
+        uint8_t _queue_head = 0;
+        uint8_t _queue_tail = 0;
+        uint8_t _queue_count = 0;
+        uint8_t _input_ptr = 0;
+
+        // the rest of the too long line is dropped up to its CR
+        bool _discard = false;
+
+        // command being executed
+        char* _buf;
+
+        const CommandDialect* _dialect;
+        uint8_t _dialect_index = DIALECT_VOLTRONIC;
+
+        Settings* _settings;
+
+        // arguments parsed from the command
+        float _args[COMMAND_MAX_ARGS];
+        uint8_t _num_args = 0;
         
         Stream* _stream;
 
         float _param[PARAM_NUMPARAM];
 
         uint8_t _status;
+        uint16_t _grand_status = 0;
+
+        // status responses rendered by publish()
+        char _qs_response[VOLTRONIC_QS_SIZE];
+        char _qbv_response[VOLTRONIC_QBV_SIZE];
 
         // sensor manipulation params
         uint8_t _sensor_ptr = 0;
         float _sensor_param_value = 0;
         uint8_t _sensor_param = 0;
+        uint8_t _profile_stage = 0;
 
+        // find the table entry matching the command and parse its arguments
+        bool find_command(CommandEntry* entry);
+        bool parse_args(const char* pattern, uint8_t pos);
 
 };
 
@@ -0,0 +1,206 @@
+#include "VoltronicCommands.h"
+
+// Handlers of the Voltronic commands
+
+int cmd_protocol(Voltronic* protocol, int result) {
+    Stream* stream = protocol->getStream();
+    stream->write(VOLTRONIC_PROMPT);
+    stream->write(protocol->getProtocol());
+    stream->println();
+    return result;
+}
+
+int cmd_status(Voltronic* protocol, int result) {
+    // rendered by publish() on the latest sensor readings
+    protocol->getStream()->write(protocol->getStatusResponse());
+    return result;
+}
+
+int cmd_dialect(Voltronic* protocol, int result) {
+    if( !protocol->selectDialect( (uint8_t) protocol->getArg(0) ) ) return COMMAND_NONE;
+
+    // confirm with the protocol of the new dialect
+    cmd_protocol(protocol, result);
+    return result;
+}
+
+static int cmd_grand_status(Voltronic* protocol, int result) {
+    Stream* stream = protocol->getStream();
+
+    // BUS voltages and the negative battery voltage are not measured
+    ex_format(stream, '(',
+        ex_fixed<4,1>(protocol->getParam(PARAM_INPUT_VAC)), ' ',
+        ex_fixed<3,1>(protocol->getParam(PARAM_INPUT_FREQ)), ' ',
+        ex_fixed<4,1>(protocol->getParam(PARAM_OUTPUT_VAC)), ' ',
+        ex_fixed<3,1>(protocol->getParam(PARAM_OUTPUT_FREQ)), ' ',
+        ex_fixed<4,1>(protocol->getParam(PARAM_OUTPUT_AC)), ' ',
+        ex_int<3>(protocol->getParam(PARAM_OUTPUT_LOAD_LEVEL) * 100), 
+        " ---.- ---.- ",
+        ex_fixed<3,1>(protocol->getParam(PARAM_BATTERY_VDC)), 
+        " ---.- ",
+        ex_fixed<4,1>(protocol->getParam(PARAM_INTERNAL_TEMP)), ' '
+    );
+
+    uint16_t status = protocol->getGrandStatus();
+    for( int8_t i = GRAND_STATUS_NUMBITS - 1; i >= 0; i-- ) 
+        stream->write( '0' + ( ( status >> i ) & 0x01 ) );
+
+    stream->println();
+    return result;
+}
+
+int cmd_rating(Voltronic* protocol, int result) {
+    ex_format(protocol->getStream(), '#',
+        ex_fixed<4,1>(protocol->getParam(PARAM_OUTPUT_VAC_NOMINAL)), ' ',
+        ex_int<3>(protocol->getParam(PARAM_OUTPUT_AC_NOMINAL)), ' ',
+        ex_fixed<3,1>(protocol->getParam(PARAM_BATTERY_VDC_NOMINAL)), ' ',
+        ex_fixed<3,1>(protocol->getParam(PARAM_OUTPUT_FREQ_NOMINAL)), "\r\n"
+    );
+    return result;
+}
+
+static int cmd_model(Voltronic* protocol, int result) {
+    ex_format(protocol->getStream(), '(',
+        ex_pstr<15>(PART_NUMBER), ' ',
+        ex_int<7>(RATED_VA), ' ',
+        ex_fixed<3>(100.0F * ACTUAL_VA / RATED_VA), ' ',
+        "1/1", ' ',
+        ex_fixed<3>(INTERACTIVE_DEFAULT_INPUT_VOLTAGE), ' ',
+        ex_fixed<3>(protocol->getParam(PARAM_OUTPUT_VAC_NOMINAL)), ' ',
+        ex_int<2>(INTERACTIVE_NUM_CELLS), ' ',
+        ex_fixed<3,1>(INTERACTIVE_MAX_V_BAT_CELL), "\r\n"
+    );
+    return result;
+}
+
+static int cmd_manufacturer(Voltronic* protocol, int result) {
+    Stream* stream = protocol->getStream();
+    stream->write('(');
+    ex_print_str_to_stream(stream, MANUFACTURER, true);
+    stream->println();
+    return result;
+}
+
+static int cmd_battery(Voltronic* protocol, int result) {
+    protocol->getStream()->write(protocol->getBatteryResponse());
+    return result;
+}
+
+int cmd_info(Voltronic* protocol, int result) {
+    ex_format(protocol->getStream(), '#',
+        ex_pstr<15>(MANUFACTURER), ' ',
+        ex_pstr<10>(PART_NUMBER), ' ',
+        ex_pstr<10>(FIRMWARE_VERSION), "\r\n"
+    );
+    return result;
+}
+
+static int cmd_reset(Voltronic*, int result) {
+    // hard reset
+    pinMode(RESET_PIN, OUTPUT);
+    digitalWrite(RESET_PIN, LOW);
+    return result;
+}
+
+int cmd_self_test(Voltronic* protocol, int result) {
+    protocol->setParam(PARAM_SELFTEST_MIN, max( protocol->getArg(0), MIN_SELFTEST_DURATION ));
+    return result;
+}
+
+int cmd_shutdown(Voltronic* protocol, int result) {
+    protocol->setParam(PARAM_SHUTDOWN_MIN, protocol->getArg(0));
+    protocol->setParam(PARAM_RESTORE_MIN, protocol->getArg(1));
+
+    return protocol->getParam(PARAM_SHUTDOWN_MIN) > 0 ? result : COMMAND_NONE;
+}
+
+#ifndef DISPLAY_TYPE_NONE
+static int cmd_brightness(Voltronic* protocol, int result) {
+    int lvl = (int) protocol->getArg(0);
+    if( lvl > DISPLAY_MAX_BRIGHTNESS ) return COMMAND_NONE;
+
+    protocol->setParam(PARAM_DISPLAY_BRIGHTNESS_LEVEL, lvl);
+    return result;
+}
+#endif
+
+static int cmd_subscribe(Voltronic* protocol, int result) {
+    protocol->setParam(PARAM_TELEMETRY_WINDOWS, protocol->getArg(0));
+    return result;
+}
+
+static int cmd_journal(Voltronic* protocol, int result) {
+    protocol->setParam(PARAM_JOURNAL_PAGE, protocol->getArg(0));
+    return result;
+}
+
+static int cmd_sensor(Voltronic* protocol, int result) {
+    protocol->setSensorPtr( (uint8_t) protocol->getArg(0) );
+    return result;
+}
+
+static int cmd_sensor_param(Voltronic* protocol, int result) {
+    protocol->setSensorPtr( (uint8_t) protocol->getArg(0) );
+    protocol->setSensorParam( (uint8_t) protocol->getArg(1) );
+    protocol->setSensorParamValue( protocol->getArg(2) );
+    return result;
+}
+
+static int cmd_upload_profile(Voltronic* protocol, int result) {
+    protocol->setSensorPtr( (uint8_t) protocol->getArg(0) );
+    protocol->setProfileStage( (uint8_t) protocol->getArg(1) );
+    protocol->setSensorParam( (uint8_t) protocol->getArg(2) );
+    protocol->setSensorParamValue( protocol->getArg(3) );
+    return result;
+}
+
+// The command table, sorted by the key
+constexpr CommandEntry VOLTRONIC_COMMANDS[] PROGMEM = {
+    // 'undocumented' - Bnn subscribes to the binary telemetry every nn sensor windows, B unsubscribes
+    { "B",   ARG_OPTIONAL ARG_MINUTES,                  cmd_subscribe,      COMMAND_SUBSCRIBE },
+    { "C",   "",                                        nullptr,            COMMAND_SHUTDOWN_CANCEL },
+    { "CT",  "",                                        nullptr,            COMMAND_SELF_TEST_CANCEL },
+#ifndef DISPLAY_TYPE_NONE
+    // 'undocumented' - DN sets the display brightness (0 - off), D toggles the display, DM - the display mode
+    { "D",   ARG_DIGIT,                                 cmd_brightness,     COMMAND_SET_BRIGHTNESS },
+    { "D",   "",                                        nullptr,            COMMAND_TOGGLE_DISPLAY },
+    { "DM",  "",                                        nullptr,            COMMAND_TOGGLE_DISPLAY_MODE },
+#endif
+    { "I",   "",                                        cmd_info,           COMMAND_NONE },
+    // 'undocumented' - MN switches to the protocol dialect N, see README
+    { "M",   ARG_DIGIT,                                 cmd_dialect,        COMMAND_SELECT_DIALECT },
+    { "M",   "",                                        cmd_protocol,       COMMAND_NONE },
+    { "Q",   "",                                        nullptr,            COMMAND_BEEPER_MUTE },
+    { "QBV", "",                                        cmd_battery,        COMMAND_NONE },
+    // 'undocumented' - QE prints the input bytes lost by the receive buffer overrun and the telemetry records dropped
+    { "QE",  "",                                        nullptr,            COMMAND_READ_ERRORS },
+    { "QGS", "",                                        cmd_grand_status,   COMMAND_NONE },
+    // 'undocumented' - QJnn prints the page nn of the power event journal, see README
+    { "QJ",  ARG_OPTIONAL ARG_MINUTES,                  cmd_journal,        COMMAND_READ_JOURNAL },
+    { "QMD", "",                                        cmd_model,          COMMAND_NONE },
+    { "QMF", "",                                        cmd_manufacturer,   COMMAND_NONE },
+    { "QRI", "",                                        cmd_rating,         COMMAND_NONE },
+    { "QS",  "",                                        cmd_status,         COMMAND_NONE },
+    { "R",   "",                                        cmd_reset,          COMMAND_NONE },
+    { "S",   ARG_MINUTES ARG_OPTIONAL "R" ARG_RESTORE,  cmd_shutdown,       COMMAND_SHUTDOWN },
+    { "T",   ARG_OPTIONAL ARG_MINUTES,                  cmd_self_test,      COMMAND_SELF_TEST },
+    { "TL",  "",                                        nullptr,            COMMAND_DEEP_TEST },
+    // 'undocumented' - sensor and charger params (N=5), see README
+    { "V",   ARG_DIGIT "P" ARG_DIGIT "V" ARG_FLOAT,     cmd_sensor_param,   COMMAND_TUNE_SENSOR },
+    { "V",   ARG_DIGIT "P" ARG_DIGIT,                   cmd_sensor_param,   COMMAND_READ_SENSOR },
+    { "V",   ARG_DIGIT "D",                             cmd_sensor,         COMMAND_DUMP_SENSOR },
+    { "V",   ARG_DIGIT "A",                             cmd_sensor,         COMMAND_AUTOTUNE_CHARGER },
+    { "V",   ARG_DIGIT "F" ARG_DIGIT,                   cmd_sensor_param,   COMMAND_SELECT_PROFILE },
+    { "V",   ARG_DIGIT "F",                             cmd_sensor,         COMMAND_PRINT_PROFILE },
+    { "V",   ARG_DIGIT "U" ARG_DIGIT ARG_DIGIT "V" ARG_FLOAT, cmd_upload_profile, COMMAND_UPLOAD_PROFILE },
+    { "V",   ARG_DIGIT "U",                             cmd_sensor,         COMMAND_PRINT_PROFILE },
+    { "V",   ARG_OPTIONAL ARG_DIGIT,                    cmd_sensor,         COMMAND_READ_SENSOR },
+    // 'undocumented' - save sensor params to EEPROM
+    { "W",   "",                                        nullptr,            COMMAND_SAVE_SENSORS }
+};
+
+const uint8_t VOLTRONIC_NUM_COMMANDS = sizeof(VOLTRONIC_COMMANDS) / sizeof(CommandEntry);
+
+static_assert( command_table_sorted(VOLTRONIC_COMMANDS, VOLTRONIC_NUM_COMMANDS), "Voltronic command table must be sorted by the key" );
+
+const CommandDialect VOLTRONIC_DIALECT = { VOLTRONIC_DEFAULT_PROTOCOL, VOLTRONIC_COMMANDS, VOLTRONIC_NUM_COMMANDS };
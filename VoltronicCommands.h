@@ -0,0 +1,16 @@
+#ifndef VoltronicCommands_h
+#define VoltronicCommands_h
+
+#include "Voltronic.h"
+
+// Handlers shared by the command tables of the protocol dialects, see VoltronicCommands.cpp
+
+int cmd_protocol(Voltronic* protocol, int result);      // M - the protocol of the active dialect
+int cmd_dialect(Voltronic* protocol, int result);       // MN - switch to the dialect N
+int cmd_status(Voltronic* protocol, int result);        // the pre-rendered status
+int cmd_rating(Voltronic* protocol, int result);        // the rated values
+int cmd_info(Voltronic* protocol, int result);          // the manufacturer, model and firmware
+int cmd_self_test(Voltronic* protocol, int result);     // TNN - self-test for NN minutes
+int cmd_shutdown(Voltronic* protocol, int result);      // SNNRMMMM - shutdown in NN and restore in MMMM minutes
+
+#endif
@@ -24,7 +24,7 @@
 #define INTERACTIVE_ERROR_OUT LED_BUILTIN
 
 #define TIMER_ONE_SEC   1000          // number of ticks to form 1 second
-#define MAX_NUM_TIMERS  5             // number of timers used
+#define MAX_NUM_TIMERS  6             // number of timers used
 
 #define INTERACTIVE_DEFAULT_INPUT_VOLTAGE 230.0F    // nominal input VAC 
 #define INTERACTIVE_INPUT_VOLTAGE_DEVIATION 0.08F   // max input VAC deviation
@@ -40,9 +40,15 @@
 #define INTERACTIVE_BATTERY_AH 9.0F                 // battery cell capacity in AH
 #define INTERACTIVE_BATTERY_LOW 0.2F                // battery is low
 #define INTERACTIVE_BATTERY_CRITICAL 0.1F           // battery is critically low
+#define INTERACTIVE_BATTERY_RATED_HOURS 20.0F       // discharge time the battery capacity is rated for (C20)
+#define INTERACTIVE_BATTERY_PEUKERT 1.15F           // default Peukert exponent of the battery (PbAc: 1.1-1.3)
+#define INTERACTIVE_BATTERY_TEMP_COEFF 0.006F       // capacity change per degree C relative to 25C
 #define INTERACTIVE_DEFAULT_FREQ 50.0F
 
+#define CHARGER_DEFAULT_PROFILE 0                   // charge profile: 0 - flooded, 1 - AGM, 2 - LiFePO4, 3 - custom
+
 #define SELF_TEST_MIN_BAT_LVL 0.8F                  // minimum required battery charge level for the selftest to run
+#define SELF_TEST_DEEP_MAX_MIN 240                  // max duration of the deep discharge test (TL) in minutes
 
 #define DISPLAY_DA_OUT   11
 #define DISPLAY_CLK_OUT  13
@@ -63,6 +69,7 @@
 #define DISPLAY_DEFAULT_BRIGHTNESS 1    // default brightness level of the display backlit
 
 #define SERIAL_MONITOR_BAUD_RATE 9600
+#define MODBUS_SLAVE_ADDRESS 1          // address of the UPS on the Modbus line, when the port is switched to Modbus RTU
 
 // the following constants are arbitrary and can be updated as necessary for a particular 
 // UPS implementation
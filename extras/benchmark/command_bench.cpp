@@ -0,0 +1,123 @@
+// Measures the serial command path of the Voltronic protocol on the host: the QS and QBV queries are read,
+// looked up and answered from the responses rendered by publish(), against rendering them for every query
+// as it was done before the caching. publish() renders both responses, so the time rendered per query is
+// above the former one by the other response. Built by the host build, see README, e.g.
+//   build/command_bench
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "Voltronic.h"
+
+// the protocol talks to the memory: the commands are read from the input, the response of the latest one is kept
+class MemoryStream : public Stream {
+    public:
+        void feed(const char* input) { _input = input; _len = 0; };
+
+        int available() { return strlen(_input); };
+        int read() { return *_input ? *_input++ : -1; };
+        int peek() { return *_input ? *_input : -1; };
+
+        size_t write(uint8_t ch) {
+            if( _len < sizeof(_output) - 1 ) _output[_len++] = ch;
+            _written++;
+            return 1;
+        };
+        int availableForWrite() { return VOLTRONIC_MIN_TX_SPACE; };
+
+        unsigned long getWritten() { return _written; };
+        void reset() { _written = 0; };
+
+        const char* response() { _output[_len] = '\0'; return _output; };
+
+    private:
+        const char* _input = "";
+        char _output[VOLTRONIC_QS_SIZE + VOLTRONIC_QBV_SIZE];
+        size_t _len = 0;
+        unsigned long _written = 0;
+};
+
+// the Modbus port is served by its own class, not linked here
+const CommandDialect MODBUS_DIALECT = { MODBUS_PROTOCOL, nullptr, 0 };
+
+// the EEPROM is not used by the queries
+bool eeprom_is_ready() { return true; }
+uint8_t eeprom_read_byte(const uint8_t*) { return 0xFF; }
+void eeprom_write_byte(uint8_t*, uint8_t) {}
+void eeprom_update_byte(uint8_t*, uint8_t) {}
+void eeprom_read_block(void* dst, const void*, size_t n) { memset(dst, 0xFF, n); }
+void eeprom_update_block(const void*, void*, size_t) {}
+
+// the reset command is not sent
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+static const int QUERIES = 200000;
+
+static double seconds() {
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
+// the sensor snapshot as refreshed by update_protocol_params() in the sketch
+static void update_params(Voltronic* protocol) {
+    protocol->setParam(PARAM_INPUT_VAC, 228.3F);
+    protocol->setParam(PARAM_INPUT_FAULT_VAC, 0.0F);
+    protocol->setParam(PARAM_INPUT_FREQ, 50.0F);
+    protocol->setParam(PARAM_OUTPUT_AC, 1.2F);
+    protocol->setParam(PARAM_OUTPUT_VAC, 221.7F);
+    protocol->setParam(PARAM_OUTPUT_LOAD_LEVEL, 0.23F);
+    protocol->setParam(PARAM_BATTERY_LEVEL, 0.97F);
+    protocol->setParam(PARAM_OUTPUT_FREQ, 50.0F);
+    protocol->setParam(PARAM_REMAINING_MIN, 42.0F);
+    protocol->setParam(PARAM_BATTERY_VDC, 27.12F);
+    protocol->setParam(PARAM_INTERNAL_TEMP, 25.0F);
+    protocol->setStatus(0x09);
+    protocol->setGrandStatus(0x0003);
+}
+
+// answer the queries, rendering the responses for each of them if render is set
+static double run(Voltronic* protocol, MemoryStream* stream, const char* query, bool render) {
+    stream->reset();
+    update_params(protocol);
+    protocol->publish();
+
+    double start = seconds();
+    for( int n = 0; n < QUERIES; n++ ) {
+        if( render ) {
+            update_params(protocol);
+            protocol->publish();
+        }
+        stream->feed(query);
+        protocol->process();
+        while( protocol->commandReady() ) protocol->executeCommand();
+    }
+    return seconds() - start;
+}
+
+int main() {
+    MemoryStream stream;
+    Settings settings;
+    Voltronic protocol(&settings, &stream);
+
+    const char* queries[] = { "QS\r", "QBV\r" };
+    int errors = 0;
+
+    for( const char* query : queries ) {
+        double rendered = run(&protocol, &stream, query, true);
+        char expected[VOLTRONIC_QS_SIZE + VOLTRONIC_QBV_SIZE];
+        strcpy(expected, stream.response());
+        unsigned long bytes = stream.getWritten() / QUERIES;
+
+        double cached = run(&protocol, &stream, query, false);
+        if( strcmp(expected, stream.response()) ) {
+            printf("%.*s: responses differ '%s' != '%s'\n", (int) strlen(query) - 1, query, expected, stream.response());
+            errors++;
+        }
+
+        printf("%.*s (%lu bytes): rendered per query %.1f ns, cached %.1f ns\n", (int) strlen(query) - 1, query,
+               bytes, 1e9 * rendered / QUERIES, 1e9 * cached / QUERIES);
+    }
+
+    return errors ? 1 : 0;
+}
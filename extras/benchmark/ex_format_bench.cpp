@@ -0,0 +1,288 @@
+// Compares ex_format() with the runtime format parser ex_printf_to_stream() it replaced, on the responses of
+// the QS, QBV, QGS and QRI queries, and prints the time and the cycles per response and the bytes written by
+// both. Built by the host build, see README, e.g.
+//   build/ex_format_bench
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define EX_BENCH_CYCLES() __rdtsc()
+#else
+#define EX_BENCH_CYCLES() 0ULL
+#endif
+
+#include "utilities.h"
+
+// the former formatter, parsing the format string and scaling the floats with pow()
+static void old_print_number_to_buf(char* _buf, float val, int len, int dec, int base = DEC, bool unsgn = false) {
+    memset(_buf, 0x0, len + 2);
+
+    int digits = fabs(val * pow(10, dec));
+    bool minus = (val < 0) && !unsgn;
+
+    for(int i=0; i < len + (dec?1:0); i++) {
+        int index = len - i - (dec?0:1);
+        if( digits ||  i <= dec ) {
+            if(i != dec || dec == 0 ) {
+                int digit = digits % base;
+                *(_buf + index) = ( digit < 10? 0x30 : 0x37 ) + digit ;
+                digits /= base;
+            }
+            else {
+                *(_buf + index) = '.';
+            }
+        }
+        else if( dec && (i == dec + 1) ) {
+            *(_buf + index) = 0x30;
+        }
+        else if(minus) {
+            *(_buf + index) = '-';
+            minus = false;
+        }
+        else {
+            *(_buf + index) = i?0x20:0x30;
+        }
+    }
+}
+
+static void old_print_number_to_stream(Print* stream, float val, int len, int dec) {
+    char buf[EX_MAX_NUMBER_LEN + 2];
+    old_print_number_to_buf(buf, val, min(len, EX_MAX_NUMBER_LEN), dec );
+    stream->print(buf);
+}
+
+static int get_width_modifier(const char* modifier, int *index) {
+    int value = 0;
+
+    while(*modifier >= '0' && *modifier <= '9') {
+        (*index)++;
+
+        value *= 10;
+        value += (*modifier - '0');
+        modifier++;
+    }
+
+    return value;
+}
+
+static int get_precision_modifier(const char* modifier, int *index) {
+    int value = 0;
+
+    if ( *modifier != '.' )
+        return (-1);
+
+    modifier++;
+    (*index)++;
+
+    if ( *modifier <= '0' || *modifier > '9' ) {
+        if (*modifier == '0')
+            (*index)++;
+        return (0);
+    }
+
+    while( *modifier >= '0' && *modifier <= '9' ) {
+        (*index)++;
+
+        value *= 10;
+        value += (*modifier - '0');
+        modifier++;
+    }
+
+    return value;
+}
+
+static void ex_printf_to_stream(Print* stream, const char* fmt, ...) {
+    va_list args;
+    int wid, prec;
+
+    va_start(args, fmt);
+
+    for(int index = 0; *(fmt + index) != '\0'; index++) {
+         // read format
+         if(*(fmt + index) == '%') {
+            index++;
+            wid = get_width_modifier(fmt + index, &index);
+            prec = get_precision_modifier(fmt + index, &index);
+            switch(*(fmt + index)) {
+                case 'b':
+                    ex_print_binary_to_stream(stream, (int) va_arg(args, int) );
+                    break;
+                case 'i':
+                    if(wid)
+                        old_print_number_to_stream(stream, (float) va_arg(args, int), wid, 0 );
+                    else
+                        stream->print((int) va_arg(args, int));
+                    break;
+
+                case 'f':
+                    if( ( wid > 0 ) && ( prec >= 0 ) ) {
+                        old_print_number_to_stream(stream, (float) va_arg(args, double), wid, prec);
+                    }
+                    else if( ( prec > 0 ) && ( wid == 0 ) ) {
+                        stream->print((float) va_arg(args, double), prec);
+                    }
+                    else {
+                        stream->print((float) va_arg(args, double));
+                    }
+                    break;
+                case 's':
+                    ex_print_str_to_stream(stream, (const char *) va_arg(args, const char*),false, wid);
+                    break;
+                case 'S':
+                    ex_print_str_to_stream(stream, (const char *) va_arg(args, const char*),true, wid);
+                    break;
+                default:
+                    stream->write(*(fmt + index));
+                    break;
+            }
+         }
+         else
+            stream->write(*(fmt + index));
+    }
+
+    va_end(args);
+}
+
+// the response is kept in the buffer, the bytes written are counted
+class CountingPrint : public BufferPrint {
+    public:
+        CountingPrint(char* buf, size_t size) : BufferPrint(buf, size) {};
+
+        size_t write(uint8_t ch) override { _written++; return BufferPrint::write(ch); };
+
+        using Print::write;
+
+        unsigned long getWritten() { return _written; };
+
+    private:
+        unsigned long _written = 0;
+};
+
+// the readings as published by the sensors. The digits below the printed ones of the input voltage, the
+// output frequency and the battery voltage are 5, so a rounding field would differ from the former truncation
+static volatile float input_vac = 228.35F;
+static volatile float fault_vac = 0.0F;
+static volatile float output_vac = 221.72F;
+static volatile float load_level = 0.231F;
+static volatile float input_freq = 50.02F;
+static volatile float output_freq = 49.95F;
+static volatile float output_ac = 1.23F;
+static volatile float battery_vdc = 27.125F;
+static volatile float battery_level = 0.971F;
+static volatile float remaining_min = 42.3F;
+static volatile float temperature = 25.01F;
+static volatile uint8_t status = 0x09;
+
+static void qs_old(Print* p) {
+    ex_printf_to_stream(p, "(%4.1f %4.1f %4.1f %3i %3.1f %3.1f %3.1f %b\r\n",
+        input_vac, fault_vac, output_vac, (int)( load_level * 100 ), output_freq, battery_vdc, temperature, status);
+}
+
+static void qs_new(Print* p) {
+    ex_format(p, '(',
+        ex_fixed<4,1>(input_vac), ' ',
+        ex_fixed<4,1>(fault_vac), ' ',
+        ex_fixed<4,1>(output_vac), ' ',
+        ex_int<3>(load_level * 100), ' ',
+        ex_fixed<3,1>(output_freq), ' ',
+        ex_fixed<3,1>(battery_vdc), ' ',
+        ex_fixed<3,1>(temperature), ' ',
+        ex_bin(status), "\r\n");
+}
+
+static void qbv_old(Print* p) {
+    ex_printf_to_stream(p, "(%4.2f %2i %2i %i %3i\r\n",
+        battery_vdc, 12, 2, (int)( battery_level * 100 ), (int) remaining_min);
+}
+
+static void qbv_new(Print* p) {
+    ex_format(p, '(',
+        ex_fixed<4,2>(battery_vdc), ' ',
+        ex_int<2>(12), ' ',
+        ex_int<2>(2), ' ',
+        (int)( battery_level * 100 ), ' ',
+        ex_int<3>(remaining_min), "\r\n");
+}
+
+static void qgs_old(Print* p) {
+    ex_printf_to_stream(p, "(%4.1f %3.1f %4.1f %3.1f %4.1f %3i ---.- ---.- %3.1f ---.- %4.1f ",
+        input_vac, input_freq, output_vac, output_freq, output_ac, (int)( load_level * 100 ), battery_vdc, temperature);
+}
+
+static void qgs_new(Print* p) {
+    ex_format(p, '(',
+        ex_fixed<4,1>(input_vac), ' ',
+        ex_fixed<3,1>(input_freq), ' ',
+        ex_fixed<4,1>(output_vac), ' ',
+        ex_fixed<3,1>(output_freq), ' ',
+        ex_fixed<4,1>(output_ac), ' ',
+        ex_int<3>(load_level * 100),
+        " ---.- ---.- ",
+        ex_fixed<3,1>(battery_vdc),
+        " ---.- ",
+        ex_fixed<4,1>(temperature), ' ');
+}
+
+static void qri_old(Print* p) {
+    ex_printf_to_stream(p, "#%4.1f %3i %3.1f %3.1f\r\n", 220.0F, 4, 24.0F, 50.0F);
+}
+
+static void qri_new(Print* p) {
+    ex_format(p, '#', ex_fixed<4,1>(220.0F), ' ', ex_int<3>(4), ' ', ex_fixed<3,1>(24.0F), ' ', ex_fixed<3,1>(50.0F), "\r\n");
+}
+
+struct Response { const char* name; void (*old_format)(Print*); void (*new_format)(Print*); };
+
+static const Response RESPONSES[] = {
+    { "QS", qs_old, qs_new },
+    { "QBV", qbv_old, qbv_new },
+    { "QGS", qgs_old, qgs_new },
+    { "QRI", qri_old, qri_new }
+};
+
+static const int CALLS = 200000;
+
+static double seconds() {
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
+struct Result { double ns; double cycles; unsigned long bytes; };
+
+static Result run(void (*format)(Print*), char* buf, size_t size) {
+    CountingPrint p(buf, size);
+
+    double start = seconds();
+    unsigned long long cycles = EX_BENCH_CYCLES();
+    for( int n = 0; n < CALLS; n++ ) {
+        p.clear();
+        format(&p);
+    }
+    cycles = EX_BENCH_CYCLES() - cycles;
+
+    return { 1e9 * ( seconds() - start ) / CALLS, (double) cycles / CALLS, p.getWritten() / CALLS };
+}
+
+int main() {
+    int errors = 0;
+
+    for( const Response& r : RESPONSES ) {
+        char expected[128], actual[128];
+        Result old_result = run(r.old_format, expected, sizeof(expected));
+        Result new_result = run(r.new_format, actual, sizeof(actual));
+
+        if( strcmp(expected, actual) ) {
+            printf("%s: responses differ '%s' != '%s'\n", r.name, expected, actual);
+            errors++;
+        }
+
+        printf("%s: ex_printf_to_stream %.1f ns %.0f cycles %lu bytes, ex_format %.1f ns %.0f cycles %lu bytes\n", r.name,
+               old_result.ns, old_result.cycles, old_result.bytes, new_result.ns, new_result.cycles, new_result.bytes);
+    }
+
+    return errors ? 1 : 0;
+}
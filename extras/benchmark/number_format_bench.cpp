@@ -0,0 +1,105 @@
+// Compares the integer ex_print_number_to_buf() with the float one it replaced, on the formats used by the
+// displays, and prints the time per call of both. Built by the host build, see README, e.g.
+//   build/number_format_bench
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "utilities.h"
+
+// the former renderer, scaling the float with pow()
+static void float_print_number_to_buf(char* _buf, float val, int len, int dec, int base, bool unsgn) {
+    memset(_buf, 0x0, len + 2);
+
+    int digits = fabs(val * pow(10, dec));
+    bool minus = (val < 0) && !unsgn;
+
+    for(int i=0; i < len + (dec?1:0); i++) {
+        int index = len - i - (dec?0:1);
+        if( digits ||  i <= dec ) {
+            if(i != dec || dec == 0 ) {
+                int digit = digits % base;
+                *(_buf + index) = ( digit < 10? 0x30 : 0x37 ) + digit ;
+                digits /= base;
+            }
+            else {
+                *(_buf + index) = '.';
+            }
+        }
+        else if( dec && (i == dec + 1) ) {
+            *(_buf + index) = 0x30;
+        }
+        else if(minus) {
+            *(_buf + index) = '-';
+            minus = false;
+        }
+        else {
+            *(_buf + index) = i?0x20:0x30;
+        }
+    }
+}
+
+struct NumberFormat { int len; int dec; int base; bool unsgn; long from; long to; };
+
+// the fields of the displays, the range is in the fixed point
+static const NumberFormat FORMATS[] = {
+    { 3, 0, DEC, false, -999, 999 },        // voltage, levels
+    { 4, 1, DEC, false, 0, 9999 },          // frequency
+    { 5, 2, DEC, false, -9999, 99999 },     // battery voltage and current
+    { 2, 0, HEX, true, 0, 255 }             // status, charger
+};
+
+static const int ROUNDS = 20;
+
+static double seconds() {
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
+int main() {
+    char expected[EX_MAX_NUMBER_LEN + 2];
+    char actual[EX_MAX_NUMBER_LEN + 2];
+    unsigned long errors = 0;
+    unsigned long calls = 0;
+    volatile char sink = 0;
+
+    for( const NumberFormat& f : FORMATS ) {
+        // the float value is scaled back, its rounding must not change the truncated digits
+        for( long v = f.from; v <= f.to; v++ ) {
+            float val = ( v + ( v < 0 ? -0.25F : 0.25F ) ) / pow(10, f.dec);
+            float_print_number_to_buf(expected, val, f.len, f.dec, f.base, f.unsgn);
+            ex_print_number_to_buf(actual, v, f.len, f.dec, f.base, f.unsgn);
+
+            // -0.x is rendered as -0 by the float version and as 0 by the fixed point one
+            if( v == 0 ) continue;
+
+            if( memcmp(expected, actual, f.len + 2) ) {
+                if( errors++ < 10 ) printf("%ld (%d,%d,%d): '%s' != '%s'\n", v, f.len, f.dec, f.base, expected, actual);
+            }
+        }
+    }
+
+    double start = seconds();
+    for( int r = 0; r < ROUNDS; r++ ) 
+        for( const NumberFormat& f : FORMATS ) 
+            for( long v = f.from; v <= f.to; v++, calls++ ) {
+                float_print_number_to_buf(expected, v / 10.0F, f.len, f.dec, f.base, f.unsgn);
+                sink += expected[0];
+            }
+    double float_time = seconds() - start;
+
+    start = seconds();
+    for( int r = 0; r < ROUNDS; r++ ) 
+        for( const NumberFormat& f : FORMATS ) 
+            for( long v = f.from; v <= f.to; v++ ) {
+                ex_print_number_to_buf(actual, v, f.len, f.dec, f.base, f.unsgn);
+                sink += actual[0];
+            }
+    double fixed_time = seconds() - start;
+
+    printf("mismatches: %lu\n", errors);
+    printf("float: %.1f ns/call, fixed point: %.1f ns/call\n", 1e9 * float_time / calls, 1e9 * fixed_time / calls);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+#ifndef LiquidCrystal_I2C_h
+#define LiquidCrystal_I2C_h
+
+// Host replacement of the LiquidCrystal_I2C library, the instructions are sent to the VirtualLCD in the same
+// order as the library does. Put this directory first on the include path of the host build.
+
+#include <Arduino.h>
+#include <Print.h>
+
+#include "VirtualLCD.h"
+
+class LiquidCrystal_I2C : public Print, public VirtualLCD {
+    public:
+        LiquidCrystal_I2C(uint8_t, uint8_t cols, uint8_t rows) : VirtualLCD(cols, rows) { 
+            _numrows = rows; 
+        };
+
+        void init() {
+            command(0x28);              // 4 bit interface, 2 lines, 5x8 font
+            display();
+            clear();
+            command(0x06);              // left to right, no shift
+            home();
+        };
+
+        void clear() { command(VIRTUAL_LCD_CMD_CLEAR); };
+        void home() { command(VIRTUAL_LCD_CMD_HOME); };
+
+        void setCursor(uint8_t col, uint8_t row) {
+            static const uint8_t row_offsets[] = { 0x00, 0x40, 0x14, 0x54 };
+            if( row >= _numrows ) row = _numrows - 1;
+            command( VIRTUAL_LCD_CMD_SET_DDRAM | ( col + row_offsets[row] ) );
+        };
+
+        void display() { _control |= VIRTUAL_LCD_DISPLAY_ON; command(VIRTUAL_LCD_CMD_DISPLAY | _control); };
+        void noDisplay() { _control &= ~VIRTUAL_LCD_DISPLAY_ON; command(VIRTUAL_LCD_CMD_DISPLAY | _control); };
+
+        void backlight() { expander(true); };
+        void noBacklight() { expander(false); };
+
+        size_t write(uint8_t value) override { data(value); return 1; };
+        using Print::write;
+
+        void printstr(const char* str) { print(str); };
+
+    private:
+        uint8_t _numrows;
+        uint8_t _control = 0;
+};
+
+#endif
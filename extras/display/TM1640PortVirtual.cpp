@@ -0,0 +1,42 @@
+// Host implementation of the TM1640Port, linked instead of TM1640Port.cpp. The bus is decoded by virtual_tm1640
+
+#include "../../TM1640Port.h"
+
+#ifdef DISPLAY_TYPE_LED_TM1640
+
+#include "VirtualTM1640.h"
+
+VirtualTM1640 virtual_tm1640;
+
+void TM1640Port::begin() {
+    virtual_tm1640.reset();
+
+    sendCommand(TM1640_CMD_DATA_FIXED);
+    for( uint8_t grid = 0; grid < TM1640_NUM_GRIDS; grid++ ) 
+        sendGrid(grid, 0);
+}
+
+void TM1640Port::setupDisplay(bool active, uint8_t intensity) {
+    sendCommand( TM1640_CMD_DISPLAY | ( active ? TM1640_DISPLAY_ON : 0 ) | min( intensity, TM1640_MAX_INTENSITY ) );
+}
+
+void TM1640Port::sendGrid(uint8_t grid, uint8_t data) {
+    start();
+    send(TM1640_CMD_ADDRESS | grid);
+    send(data);
+    stop();
+}
+
+void TM1640Port::sendCommand(uint8_t cmd) {
+    start();
+    send(cmd);
+    stop();
+}
+
+void TM1640Port::start() { virtual_tm1640.start(); }
+
+void TM1640Port::stop() { virtual_tm1640.stop(); }
+
+void TM1640Port::send(uint8_t data) { virtual_tm1640.send(data); }
+
+#endif
@@ -0,0 +1,62 @@
+#include <string.h>
+
+#include "VirtualLCD.h"
+
+// DDRAM address of the row start
+static const uint8_t ROW_OFFSETS[VIRTUAL_LCD_MAX_ROWS] = { 0x00, 0x40, 0x14, 0x54 };
+
+VirtualLCD::VirtualLCD(uint8_t cols, uint8_t rows) {
+    _cols = cols < VIRTUAL_LCD_MAX_COLS ? cols : VIRTUAL_LCD_MAX_COLS;
+    _rows = rows < VIRTUAL_LCD_MAX_ROWS ? rows : VIRTUAL_LCD_MAX_ROWS;
+    memset(_ddram, ' ', sizeof(_ddram));
+}
+
+void VirtualLCD::command(uint8_t value) {
+    _bytes++;
+    _transactions += VIRTUAL_LCD_I2C_PER_BYTE;
+
+    if( value & VIRTUAL_LCD_CMD_SET_DDRAM ) 
+        _addr = index( value & ~VIRTUAL_LCD_CMD_SET_DDRAM );
+    else if( value == VIRTUAL_LCD_CMD_CLEAR ) {
+        memset(_ddram, ' ', sizeof(_ddram));
+        _addr = 0;
+    }
+    else if( ( value & ~0x01 ) == VIRTUAL_LCD_CMD_HOME ) 
+        _addr = 0;
+    else if( ( value & 0xF8 ) == VIRTUAL_LCD_CMD_DISPLAY ) 
+        _on = value & VIRTUAL_LCD_DISPLAY_ON;
+}
+
+void VirtualLCD::data(uint8_t value) {
+    _bytes++;
+    _transactions += VIRTUAL_LCD_I2C_PER_BYTE;
+
+    _ddram[_addr] = (char) value;
+    _addr = ( _addr + 1 ) % sizeof(_ddram);
+}
+
+// the addresses 0x28-0x3F and 0x68-0x7F are not in the DDRAM, they are taken modulo the line
+uint8_t VirtualLCD::index(uint8_t addr) {
+    uint8_t line = addr >= VIRTUAL_LCD_LINE_2_ADDR ? 1 : 0;
+    return line * VIRTUAL_LCD_LINE_SIZE + ( addr - line * VIRTUAL_LCD_LINE_2_ADDR ) % VIRTUAL_LCD_LINE_SIZE;
+}
+
+void VirtualLCD::expander(bool backlight) {
+    _transactions++;
+    _backlight = backlight;
+}
+
+const char* VirtualLCD::frame() {
+    char* p = _frame;
+    for( uint8_t row = 0; row < _rows; row++ ) {
+        memcpy(p, _ddram + index(ROW_OFFSETS[row]), _cols);
+        p += _cols;
+        *p++ = '\n';
+    }
+    *p = '\0';
+    return _frame;
+}
+
+bool VirtualLCD::matches(const char* golden) {
+    return strcmp(frame(), golden) == 0;
+}
@@ -0,0 +1,72 @@
+#ifndef VirtualLCD_h
+#define VirtualLCD_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VIRTUAL_LCD_MAX_COLS            20
+#define VIRTUAL_LCD_MAX_ROWS            4
+#define VIRTUAL_LCD_LINE_SIZE           40      // the DDRAM of the 2 line mode, the lines start at 0x00 and 0x40
+#define VIRTUAL_LCD_NUM_LINES           2
+#define VIRTUAL_LCD_LINE_2_ADDR         0x40
+#define VIRTUAL_LCD_I2C_PER_BYTE        6       // 2 nibbles, each is written to the expander with E low, high, low
+#define VIRTUAL_LCD_FRAME_SIZE          ( ( VIRTUAL_LCD_MAX_COLS + 1 ) * VIRTUAL_LCD_MAX_ROWS + 1 )
+
+// HD44780 instructions emulated by VirtualLCD
+#define VIRTUAL_LCD_CMD_CLEAR           0x01
+#define VIRTUAL_LCD_CMD_HOME            0x02
+#define VIRTUAL_LCD_CMD_DISPLAY         0x08    // display control, bit 2 - display on
+#define VIRTUAL_LCD_DISPLAY_ON          0x04
+#define VIRTUAL_LCD_CMD_SET_DDRAM       0x80
+
+/**
+ * @brief VirtualLCD is a host side model of the HD44780 behind the PCF8574 I2C expander. Instructions and
+ *        characters are written to the display data RAM, and the frame is read from it by the row addresses.
+ *        The DDRAM is the 2 lines of 40 characters, 0x00-0x27 and 0x40-0x67. Writing past the end of a row
+ *        continues in the DDRAM and past the end of a line in the other line, just like the real controller.
+ *        The bytes and the I2C transactions are counted, so the cost of a refresh can be measured.
+ */
+class VirtualLCD {
+    public:
+        VirtualLCD(uint8_t cols, uint8_t rows);
+
+        // instruction or character, as sent by the LiquidCrystal_I2C library
+        void command(uint8_t value);
+        void data(uint8_t value);
+
+        // backlight switch is a single write to the expander
+        void expander(bool backlight);
+
+        // frame shown by the display, the rows are terminated by '\n'
+        const char* frame();
+
+        // compare the frame with the golden one, e.g. "I: 230V...\nO: 230V...\n"
+        bool matches(const char* golden);
+
+        bool isOn() const { return _on; };
+        bool isBacklight() const { return _backlight; };
+
+        unsigned long getBytes() const { return _bytes; };
+        unsigned long getTransactions() const { return _transactions; };
+        void resetStats() { _bytes = 0; _transactions = 0; };
+
+    private:
+        uint8_t _cols, _rows;
+
+        // the lines one after another, the address counter is the index here
+        char _ddram[VIRTUAL_LCD_NUM_LINES * VIRTUAL_LCD_LINE_SIZE];
+        uint8_t _addr = 0;
+
+        // the index of the DDRAM address
+        static uint8_t index(uint8_t addr);
+
+        bool _on = false;
+        bool _backlight = false;
+
+        char _frame[VIRTUAL_LCD_FRAME_SIZE];
+
+        unsigned long _bytes = 0;
+        unsigned long _transactions = 0;
+};
+
+#endif
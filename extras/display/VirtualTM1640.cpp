@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "VirtualTM1640.h"
+
+void VirtualTM1640::reset() {
+    memset(_grids, 0x0, sizeof(_grids));
+    _addr = 0;
+    _fixed = false;
+    _on = false;
+    _intensity = 0;
+    _pos = 0;
+    _data = false;
+    resetStats();
+}
+
+void VirtualTM1640::start() {
+    _pos = 0;
+    _data = false;
+}
+
+void VirtualTM1640::send(uint8_t value) {
+    _bytes++;
+
+    if( _pos++ == 0 ) {
+        switch( value & VIRTUAL_TM1640_CMD_MASK ) {
+            case VIRTUAL_TM1640_CMD_DATA:
+                _fixed = value & VIRTUAL_TM1640_FIXED_ADDRESS;
+                break;
+            case VIRTUAL_TM1640_CMD_DISPLAY:
+                _on = value & VIRTUAL_TM1640_DISPLAY_ON;
+                _intensity = value & 0x07;
+                break;
+            case VIRTUAL_TM1640_CMD_ADDRESS:
+                _addr = value & ( VIRTUAL_TM1640_NUM_GRIDS - 1 );
+                _data = true;
+                break;
+        }
+        return;
+    }
+
+    // the bytes after the address are the data, the address is advanced in the auto increment mode
+    if( !_data ) return;
+
+    _grids[_addr] = value;
+    if( !_fixed ) _addr = ( _addr + 1 ) & ( VIRTUAL_TM1640_NUM_GRIDS - 1 );
+}
+
+void VirtualTM1640::stop() {
+    _transactions++;
+}
+
+const char* VirtualTM1640::frame() {
+    char* p = _frame;
+    for( uint8_t i = 0; i < VIRTUAL_TM1640_NUM_GRIDS; i++ ) 
+        p += sprintf(p, i ? " %02x" : "%02x", _grids[i]);
+    return _frame;
+}
+
+bool VirtualTM1640::matches(const uint8_t* golden, uint8_t size) const {
+    return size <= VIRTUAL_TM1640_NUM_GRIDS && memcmp(_grids, golden, size) == 0;
+}
@@ -0,0 +1,71 @@
+#ifndef VirtualTM1640_h
+#define VirtualTM1640_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VIRTUAL_TM1640_NUM_GRIDS        16
+#define VIRTUAL_TM1640_FRAME_SIZE       ( VIRTUAL_TM1640_NUM_GRIDS * 3 + 1 )
+
+// TM1640 commands, the first byte after the start condition
+#define VIRTUAL_TM1640_CMD_MASK         0xC0
+#define VIRTUAL_TM1640_CMD_DATA         0x40    // bit 2 - fixed address
+#define VIRTUAL_TM1640_CMD_DISPLAY      0x80    // bit 3 - display on, bits 0-2 - intensity
+#define VIRTUAL_TM1640_CMD_ADDRESS      0xC0    // followed by the data
+#define VIRTUAL_TM1640_FIXED_ADDRESS    0x04
+#define VIRTUAL_TM1640_DISPLAY_ON       0x08
+
+/**
+ * @brief VirtualTM1640 is a host side model of the TM1640. The bytes framed by the start and stop conditions are
+ *        decoded into the segments of the grids, in the fixed or the auto increment address mode. The bytes and
+ *        the transactions (start to stop) are counted, so the cost of a refresh can be measured.
+ */
+class VirtualTM1640 {
+    public:
+        VirtualTM1640() { reset(); };
+
+        // transaction on the bus
+        void start();
+        void send(uint8_t value);
+        void stop();
+
+        // segments of the grid, bit 0 is sent first
+        uint8_t grid(uint8_t index) const { return _grids[index % VIRTUAL_TM1640_NUM_GRIDS]; };
+        const uint8_t* grids() const { return _grids; };
+
+        // frame as the hex bytes of the grids, e.g. "fa 0a 00 ..."
+        const char* frame();
+
+        // compare the first size grids with the golden ones
+        bool matches(const uint8_t* golden, uint8_t size) const;
+
+        bool isOn() const { return _on; };
+        uint8_t getIntensity() const { return _intensity; };
+
+        unsigned long getBytes() const { return _bytes; };
+        unsigned long getTransactions() const { return _transactions; };
+        void resetStats() { _bytes = 0; _transactions = 0; };
+
+        void reset();
+
+    private:
+        uint8_t _grids[VIRTUAL_TM1640_NUM_GRIDS];
+        uint8_t _addr;
+        bool _fixed;
+        bool _on;
+        uint8_t _intensity;
+
+        // position of the byte in the transaction
+        uint8_t _pos;
+        bool _data;
+
+        char _frame[VIRTUAL_TM1640_FRAME_SIZE];
+
+        unsigned long _bytes;
+        unsigned long _transactions;
+};
+
+// the chip driven by the host implementation of TM1640Port, see TM1640PortVirtual.cpp
+extern VirtualTM1640 virtual_tm1640;
+
+#endif
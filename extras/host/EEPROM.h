@@ -0,0 +1,33 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+// Host replacement of the Arduino EEPROM library, built on the eeprom_* functions like the original.
+// The memory is kept in the file by HAL_Linux.cpp
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+#include <avr/io.h>
+
+struct EEPROMClass {
+    uint8_t read(int idx) { return eeprom_read_byte( (const uint8_t*)(intptr_t) idx ); };
+    void write(int idx, uint8_t val) { eeprom_write_byte( (uint8_t*)(intptr_t) idx, val ); };
+    void update(int idx, uint8_t val) { eeprom_update_byte( (uint8_t*)(intptr_t) idx, val ); };
+
+    uint16_t length() { return E2END + 1; };
+
+    template<typename T> T& get(int idx, T& t) {
+        uint8_t* ptr = (uint8_t*) &t;
+        for( int count = sizeof(T); count; --count, ++idx ) *ptr++ = read(idx);
+        return t;
+    };
+
+    template<typename T> const T& put(int idx, const T& t) {
+        const uint8_t* ptr = (const uint8_t*) &t;
+        for( int count = sizeof(T); count; --count, ++idx ) update(idx, *ptr++);
+        return t;
+    };
+};
+
+static EEPROMClass EEPROM __attribute__((unused));
+
+#endif
@@ -0,0 +1,527 @@
+// Linux implementation of the HAL and of the Arduino core, so the firmware runs as a process on a PC.
+//
+// The 1ms tick is the SIGALRM of an interval timer, its handler calls the interrupt handlers of the firmware.
+// The interrupts are disabled by blocking the signal. The USART is stdin/stdout or a pseudo terminal, paced at
+// the baud rate. The EEPROM is kept in a file. The ADC inputs are produced by a simple model of the UPS: the mains,
+// the relays, the inverter, the load and the battery charged by the PWM of the charger.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <avr/wdt.h>
+
+#include "config.h"
+#include "HAL.h"
+
+#define HOST_EXIT_WATCHDOG      3       // exit status on the watchdog reset
+#define HOST_EXIT_RESET         4       // exit status on the reset by the RESET_PIN
+
+#define HOST_BYTE_CREDIT        10000   // baud * 1ms per byte of 10 bits
+
+// the default calibration of the sensors in UPSCore.ino, the model is converted to the ADC readings with it
+#define HOST_VAC_IN_MEDIAN      ( 512 - 73 )
+#define HOST_VAC_IN_SCALE       2.63F
+#define HOST_VAC_OUT_MEDIAN     512
+#define HOST_VAC_OUT_SCALE      2.28F
+#define HOST_AC_OUT_SCALE       0.007F
+#define HOST_V_BAT_SCALE        0.05298F
+#define HOST_C_BAT_OFFSET       -37.61F
+#define HOST_C_BAT_SCALE        0.07362F
+
+#define HOST_REGULATE_STEP      0.13F   // output change by the autotransformer relays
+#define HOST_INVERTER_EFFICIENCY 0.85F
+#define HOST_MAX_CHARGE_C       8.0F    // charge current at the full PWM duty, Amp
+#define HOST_BATTERY_R          0.05F   // internal resistance of the battery, Ohm
+#define HOST_CHARGER_TAU        100.0F  // time constant of the charge current following the PWM, ticks
+
+// interrupt handlers of the firmware, the ones not linked are skipped
+extern "C" void TIMER0_COMPA_vect(void) __attribute__((weak));
+extern "C" void USART_RX_vect(void) __attribute__((weak));
+extern "C" void USART_UDRE_vect(void) __attribute__((weak));
+
+extern void setup();
+extern void loop();
+
+static struct timespec start_time;
+
+static volatile sig_atomic_t interrupts = 0;
+static volatile sig_atomic_t timer_running = 0;
+static volatile unsigned long tick_start = 0;
+static volatile unsigned long ticks = 0;         // the simulated time, the signals may come late
+static sigset_t tick_signal;
+
+static volatile uint16_t pwm_duty = 0;
+static uint8_t pin_modes[NUM_DIGITAL_PINS];
+static volatile uint8_t pin_states[NUM_DIGITAL_PINS];
+static bool trace_pins = false;
+
+static int uart_in = STDIN_FILENO;
+static int uart_out = STDOUT_FILENO;
+static bool uart_stdio = true;
+static unsigned long uart_baud = 0;
+static unsigned long rx_credit = 0;
+static unsigned long tx_credit = 0;
+static volatile uint8_t rx_data = 0;
+static volatile sig_atomic_t tx_enabled = 0;
+static volatile sig_atomic_t tx_complete = 0;
+
+static uint8_t eeprom[E2END + 1];
+static int eeprom_fd = -1;
+static unsigned long eeprom_busy_since = 0;
+static bool eeprom_busy = false;
+
+static volatile uint16_t wdt_period = 0;
+static volatile uint16_t wdt_counter = 0;
+
+// the model of the UPS
+static volatile float mains_vac = INTERACTIVE_DEFAULT_INPUT_VOLTAGE;
+static float mains_freq = INTERACTIVE_DEFAULT_FREQ;
+static volatile sig_atomic_t mains_fail = 0;
+static float load_ac = 1.0F;
+static float battery_ah = INTERACTIVE_BATTERY_AH * INTERACTIVE_NUM_BATTERY_PACKS;
+static float battery_empty = INTERACTIVE_MIN_V_BAT_CELL * INTERACTIVE_NUM_CELLS;
+static float battery_full = INTERACTIVE_STBY_V_BAT_CELL * INTERACTIVE_NUM_CELLS;
+static volatile float battery_charge = 0.9F;
+static volatile float battery_c = 0.0F;
+
+static unsigned long run_time = 0;
+
+static void trace(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+static void trace(const char* format, ...) {
+    char buf[96];
+    int n = snprintf(buf, sizeof(buf), "[%8lu] ", millis());
+
+    va_list args;
+    va_start(args, format);
+    n += vsnprintf(buf + n, sizeof(buf) - n, format, args);
+    va_end(args);
+
+    // write() is safe in the signal handler
+    if( write(STDERR_FILENO, buf, min(n, (int) sizeof(buf) - 1)) < 0 ) return;
+}
+
+// time
+
+unsigned long micros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)( ( now.tv_sec - start_time.tv_sec ) * 1000000L + ( now.tv_nsec - start_time.tv_nsec ) / 1000 );
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void delay(unsigned long ms) {
+    unsigned long start = micros();
+    unsigned long duration = ms * 1000;
+
+    // the sleep is interrupted by the ticks
+    while( micros() - start < duration ) {
+        unsigned long left = duration - ( micros() - start );
+        struct timespec ts = { (time_t)( left / 1000000 ), (long)( left % 1000000 ) * 1000 };
+        nanosleep(&ts, nullptr);
+    }
+}
+
+void delayMicroseconds(unsigned int us) {
+    unsigned long start = micros();
+    while( micros() - start < us );
+}
+
+// interrupts
+
+void hal_cli() {
+    sigprocmask(SIG_BLOCK, &tick_signal, nullptr);
+    interrupts = 0;
+}
+
+void hal_sei() {
+    interrupts = 1;
+    sigprocmask(SIG_UNBLOCK, &tick_signal, nullptr);
+}
+
+bool hal_interrupts_enabled() {
+    return interrupts;
+}
+
+// pins
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if( pin < NUM_DIGITAL_PINS ) pin_modes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if( pin >= NUM_DIGITAL_PINS ) return;
+
+    if( trace_pins && pin_states[pin] != val ) trace("pin %u %s\n", pin, val ? "HIGH" : "LOW");
+    pin_states[pin] = val;
+
+    // the RESET_PIN is wired to the reset of the board
+    if( pin == RESET_PIN && pin_modes[pin] == OUTPUT && val == LOW ) {
+        trace("reset\n");
+        _exit(HOST_EXIT_RESET);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    if( pin >= NUM_DIGITAL_PINS ) return LOW;
+    if( pin_modes[pin] == INPUT_PULLUP && pin_states[pin] == LOW ) return HIGH;
+    return pin_states[pin];
+}
+
+// the model of the UPS
+
+static float battery_vdc() {
+    return battery_empty + battery_charge * ( battery_full - battery_empty ) + battery_c * HOST_BATTERY_R;
+}
+
+static float input_vac() {
+    return mains_fail ? 0.0F : mains_vac;
+}
+
+static float output_vac() {
+    if( pin_states[INTERACTIVE_INVERTER_OUT] ) return INTERACTIVE_DEFAULT_INPUT_VOLTAGE;
+    if( !pin_states[INTERACTIVE_INPUT_RLY_OUT] ) return 0.0F;
+
+    float vac = input_vac();
+    if( pin_states[INTERACTIVE_LEFT_RLY_OUT] ) vac *= 1.0F - HOST_REGULATE_STEP;
+    if( pin_states[INTERACTIVE_RIGHT_RLY_OUT] ) vac *= 1.0F + HOST_REGULATE_STEP;
+    return vac;
+}
+
+static float load_current() {
+    return pin_states[INTERACTIVE_OUTPUT_RLY_OUT] && output_vac() > 0.0F ? load_ac : 0.0F;
+}
+
+// the battery is charged by the PWM on the mains and discharged by the inverter, called every tick
+static void update_battery() {
+    if( pin_states[INTERACTIVE_INVERTER_OUT] )
+        battery_c = - load_current() * output_vac() / ( battery_vdc() * HOST_INVERTER_EFFICIENCY );
+    else if( pin_states[INTERACTIVE_INPUT_RLY_OUT] && input_vac() > 0.0F )
+        battery_c += ( HOST_MAX_CHARGE_C * pwm_duty / 1023.0F - max(battery_c, 0.0F) ) / HOST_CHARGER_TAU;
+    else
+        battery_c = 0.0F;
+
+    float charge = battery_charge + battery_c / ( battery_ah * 3600.0F * TIMER_ONE_SEC );
+    battery_charge = constrain(charge, 0.0F, 1.0F);
+}
+
+static int adc(float value) {
+    return constrain( (int) lroundf(value), 0, 1023 );
+}
+
+// the signal is sampled at the tick, so the late signals do not distort its shape.
+// The phase is taken in double, the float would lose it in a few minutes
+static float sine(float freq) {
+    return (float) sin( 2.0 * PI * fmod( (double) freq * ticks / TIMER_ONE_SEC, 1.0 ) );
+}
+
+int analogRead(uint8_t pin) {
+    switch( pin ) {
+        case SENSOR_INPUT_VAC_IN:
+            return adc( HOST_VAC_IN_MEDIAN + input_vac() * (float) M_SQRT2 / HOST_VAC_IN_SCALE * sine(mains_freq) );
+        case SENSOR_OUTPUT_VAC_IN:
+            return adc( HOST_VAC_OUT_MEDIAN + output_vac() * (float) M_SQRT2 / HOST_VAC_OUT_SCALE *
+                        sine( pin_states[INTERACTIVE_INVERTER_OUT] ? INTERACTIVE_DEFAULT_FREQ : mains_freq ) );
+        case SENSOR_OUTPUT_C_IN:
+            return adc( load_current() / HOST_AC_OUT_SCALE );
+        case SENSOR_BAT_V_IN:
+            return adc( battery_vdc() / HOST_V_BAT_SCALE );
+        case SENSOR_BAT_C_IN:
+            return adc( ( battery_c - HOST_C_BAT_OFFSET ) / HOST_C_BAT_SCALE );
+        default:
+            return 0;
+    }
+}
+
+// EEPROM
+
+bool eeprom_is_ready() {
+    if( eeprom_busy && micros() - eeprom_busy_since >= 3400 ) eeprom_busy = false;
+    return !eeprom_busy;
+}
+
+uint8_t eeprom_read_byte(const uint8_t* addr) {
+    while( !eeprom_is_ready() );
+    return eeprom[(uintptr_t) addr & E2END];
+}
+
+void eeprom_write_byte(uint8_t* addr, uint8_t value) {
+    while( !eeprom_is_ready() );
+
+    uintptr_t a = (uintptr_t) addr & E2END;
+    eeprom[a] = value;
+    if( eeprom_fd >= 0 && pwrite(eeprom_fd, &value, 1, a) != 1 ) perror("eeprom");
+
+    eeprom_busy = true;
+    eeprom_busy_since = micros();
+}
+
+void eeprom_update_byte(uint8_t* addr, uint8_t value) {
+    if( eeprom_read_byte(addr) != value ) eeprom_write_byte(addr, value);
+}
+
+void eeprom_read_block(void* dst, const void* src, size_t n) {
+    for( size_t i = 0; i < n; i++ )
+        ( (uint8_t*) dst )[i] = eeprom_read_byte( (const uint8_t*) src + i );
+}
+
+void eeprom_update_block(const void* src, void* dst, size_t n) {
+    for( size_t i = 0; i < n; i++ )
+        eeprom_update_byte( (uint8_t*) dst + i, ( (const uint8_t*) src )[i] );
+}
+
+// the erased EEPROM reads 0xFF, the file is extended to the full size
+static bool eeprom_open(const char* path) {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+
+    eeprom_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if( eeprom_fd < 0 ) return false;
+
+    ssize_t n = pread(eeprom_fd, eeprom, sizeof(eeprom), 0);
+    if( n < 0 ) return false;
+
+    if( n < (ssize_t) sizeof(eeprom) )
+        return pwrite(eeprom_fd, eeprom + n, sizeof(eeprom) - n, n) == (ssize_t)( sizeof(eeprom) - n );
+
+    return true;
+}
+
+// watchdog
+
+void wdt_enable(uint8_t timeout) {
+    wdt_counter = 0;
+    wdt_period = 15 << timeout;
+}
+
+void wdt_disable() {
+    wdt_period = 0;
+}
+
+void wdt_reset() {
+    wdt_counter = 0;
+}
+
+// timers
+
+static void uart_tick();
+
+static void on_tick(int) {
+    int saved_errno = errno;
+
+    // the interrupts are disabled in the handler, like on AVR
+    interrupts = 0;
+    tick_start = micros();
+
+    if( timer_running ) {
+        ticks++;
+        update_battery();
+
+        if( TIMER0_COMPA_vect ) TIMER0_COMPA_vect();
+        uart_tick();
+
+        if( wdt_period && ++wdt_counter > wdt_period ) {
+            trace("watchdog reset\n");
+            _exit(HOST_EXIT_WATCHDOG);
+        }
+    }
+
+    interrupts = 1;
+    errno = saved_errno;
+}
+
+static void on_mains(int) {
+    mains_fail = !mains_fail;
+    trace("mains %s\n", mains_fail ? "off" : "on");
+}
+
+void hal_begin_timers() {
+    struct sigaction action = {};
+    action.sa_handler = on_tick;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &action, nullptr);
+
+    struct itimerval period = { { 0, 1000000 / TIMER_ONE_SEC }, { 0, 1000000 / TIMER_ONE_SEC } };
+    setitimer(ITIMER_REAL, &period, nullptr);
+
+    timer_running = 1;
+}
+
+uint16_t hal_tick_latency() {
+    return (uint16_t)( micros() - tick_start );
+}
+
+void hal_pwm_write(uint16_t value) {
+    pwm_duty = min(value, (uint16_t) 1023);
+}
+
+// the clock of the timer and the USART is stopped in the power down
+void hal_sleep(uint32_t timeout) {
+    wdt_disable();
+    timer_running = 0;
+
+    delay(timeout * 250);
+
+    timer_running = 1;
+    wdt_enable(WDTO_2S);
+}
+
+// USART
+
+void hal_uart_begin(unsigned long baud) {
+    uart_baud = baud;
+}
+
+void hal_uart_start_tx() {
+    tx_complete = 0;
+    tx_enabled = 1;
+}
+
+void hal_uart_stop_tx() {
+    tx_enabled = 0;
+}
+
+bool hal_uart_tx_ready() {
+    return true;
+}
+
+bool hal_uart_tx_complete() {
+    return tx_complete;
+}
+
+uint8_t hal_uart_read() {
+    return rx_data;
+}
+
+void hal_uart_write(uint8_t ch) {
+    if( write(uart_out, &ch, 1) < 0 && errno != EAGAIN ) tx_enabled = 0;
+    tx_complete = 1;
+}
+
+// the bytes are received and sent at the baud rate
+static void uart_tick() {
+    if( !uart_baud ) return;
+
+    rx_credit = min(rx_credit + uart_baud, 2UL * HOST_BYTE_CREDIT);
+    while( rx_credit >= HOST_BYTE_CREDIT ) {
+        uint8_t ch;
+        if( read(uart_in, &ch, 1) != 1 ) break;
+
+        rx_credit -= HOST_BYTE_CREDIT;
+
+        // the lines typed in the terminal end with the CR expected by the protocol
+        if( uart_stdio && ch == '\n' ) ch = '\r';
+
+        rx_data = ch;
+        if( USART_RX_vect ) USART_RX_vect();
+    }
+
+    tx_credit = min(tx_credit + uart_baud, 2UL * HOST_BYTE_CREDIT);
+    while( tx_enabled && tx_credit >= HOST_BYTE_CREDIT && USART_UDRE_vect ) {
+        tx_credit -= HOST_BYTE_CREDIT;
+        USART_UDRE_vect();
+    }
+}
+
+static bool uart_open_pty() {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if( master < 0 || grantpt(master) || unlockpt(master) ) return false;
+
+    // the slave is kept open, so the master does not fail till the client connects
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if( slave < 0 ) return false;
+
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    uart_in = uart_out = master;
+    uart_stdio = false;
+
+    fprintf(stderr, "serial port: %s\n", ptsname(master));
+    return true;
+}
+
+static void usage(const char* name) {
+    fprintf(stderr,
+        "usage: %s [-e eeprom.bin] [-p] [-t seconds] [-g] [-v vac] [-f freq] [-l load] [-c charge]\n"
+        "  -e  keep the EEPROM in the file, erased EEPROM otherwise\n"
+        "  -p  serial port on a pseudo terminal, stdin/stdout otherwise\n"
+        "  -t  exit after the time\n"
+        "  -g  trace the pin changes to stderr\n"
+        "  -v  mains voltage, %.0fV\n"
+        "  -f  mains frequency, %.0fHz\n"
+        "  -l  load current, %.1fA\n"
+        "  -c  battery charge, %.2f\n"
+        "SIGUSR1 switches the mains off and on\n",
+        name, mains_vac, mains_freq, load_ac, battery_charge);
+}
+
+int main(int argc, char** argv) {
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    sigemptyset(&tick_signal);
+    sigaddset(&tick_signal, SIGALRM);
+
+    memset(eeprom, 0xFF, sizeof(eeprom));
+
+    int opt;
+    while( ( opt = getopt(argc, argv, "e:pt:gv:f:l:c:h") ) != -1 ) {
+        switch( opt ) {
+            case 'e':
+                if( !eeprom_open(optarg) ) {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                if( !uart_open_pty() ) {
+                    perror("pty");
+                    return 1;
+                }
+                break;
+            case 't': run_time = strtoul(optarg, nullptr, 10) * 1000; break;
+            case 'g': trace_pins = true; break;
+            case 'v': mains_vac = strtof(optarg, nullptr); break;
+            case 'f': mains_freq = strtof(optarg, nullptr); break;
+            case 'l': load_ac = strtof(optarg, nullptr); break;
+            case 'c': battery_charge = constrain(strtof(optarg, nullptr), 0.0F, 1.0F); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if( uart_stdio ) fcntl(uart_in, F_SETFL, fcntl(uart_in, F_GETFL) | O_NONBLOCK);
+
+    struct sigaction action = {};
+    action.sa_handler = on_mains;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+
+    // the interrupts are enabled by the core before the setup
+    hal_sei();
+
+    setup();
+
+    for(;;) {
+        loop();
+        if( run_time && millis() >= run_time ) break;
+    }
+
+    return 0;
+}
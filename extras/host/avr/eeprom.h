@@ -0,0 +1,19 @@
+#ifndef _AVR_EEPROM_H_
+#define _AVR_EEPROM_H_
+
+// Host replacement of avr/eeprom.h, implemented by HAL_Linux.cpp. A write keeps the EEPROM busy for 3.4ms
+// like the ATmega328P
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern bool eeprom_is_ready();
+
+extern uint8_t eeprom_read_byte(const uint8_t* addr);
+extern void eeprom_write_byte(uint8_t* addr, uint8_t value);
+extern void eeprom_update_byte(uint8_t* addr, uint8_t value);
+
+extern void eeprom_read_block(void* dst, const void* src, size_t n);
+extern void eeprom_update_block(const void* src, void* dst, size_t n);
+
+#endif
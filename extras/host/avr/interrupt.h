@@ -0,0 +1,15 @@
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+// Host replacement of avr/interrupt.h. The handlers are called by HAL_Linux.cpp from the signal of its timer,
+// the interrupts are disabled by blocking the signal
+
+#define ISR(vector, ...) extern "C" void vector(void); void vector(void)
+
+extern void hal_cli();
+extern void hal_sei();
+
+#define cli() hal_cli()
+#define sei() hal_sei()
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+// Host replacement of avr/io.h. There are no registers, the hardware is accessed by the HAL
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+
+#define E2END 0x3FF             // ATmega328P
+
+#endif
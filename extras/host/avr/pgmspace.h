@@ -0,0 +1,23 @@
+#ifndef __PGMSPACE_H_
+#define __PGMSPACE_H_
+
+// Host replacement of avr/pgmspace.h, the program memory is the data memory
+
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+
+#endif
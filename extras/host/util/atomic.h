@@ -0,0 +1,20 @@
+#ifndef _UTIL_ATOMIC_H_
+#define _UTIL_ATOMIC_H_
+
+// Host replacement of util/atomic.h, the same construct over the interrupts of HAL_Linux.cpp
+
+#include <stdint.h>
+#include <avr/interrupt.h>
+
+extern bool hal_interrupts_enabled();
+
+static inline uint8_t __iCliRetVal() { cli(); return 1; }
+static inline void __iRestore(const uint8_t* state) { if( *state ) sei(); }
+static inline void __iSeiParam(const uint8_t*) { sei(); }
+
+#define ATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = hal_interrupts_enabled()
+#define ATOMIC_FORCEON uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+
+#define ATOMIC_BLOCK(type) for( type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0 )
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _UTIL_CRC16_H_
+#define _UTIL_CRC16_H_
+
+// Host replacement of util/crc16.h, the C equivalents given by avr-libc
+
+#include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a) {
+    crc ^= a;
+    for( int i = 0; i < 8; ++i ) 
+        crc = ( crc & 1 ) ? ( crc >> 1 ) ^ 0xA001 : ( crc >> 1 );
+    return crc;
+}
+
+static inline uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data) {
+    crc = crc ^ ( (uint16_t) data << 8 );
+    for( int i = 0; i < 8; i++ ) 
+        crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : ( crc << 1 );
+    return crc;
+}
+
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+    data ^= crc & 0xFF;
+    data ^= data << 4;
+    return ( ( (uint16_t) data << 8 ) | ( crc >> 8 ) ) ^ (uint8_t)( data >> 4 ) ^ ( (uint16_t) data << 3 );
+}
+
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for( int i = 0; i < 8; i++ ) 
+        crc = ( crc & 0x80 ) ? ( crc << 1 ) ^ 0x07 : ( crc << 1 );
+    return crc;
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef _UTIL_DELAY_H_
+#define _UTIL_DELAY_H_
+
+// Host replacement of util/delay.h
+
+#include <Arduino.h>
+
+static inline void _delay_us(double us) { delayMicroseconds( (unsigned int) ceil(us) ); }
+static inline void _delay_ms(double ms) { delay( (unsigned long) ceil(ms) ); }
+
+#endif
@@ -0,0 +1,63 @@
+#include <string.h>
+
+#include "TelemetryDecoder.h"
+
+void TelemetryDecoder::reset() {
+    _len = 0;
+    _has_record = false;
+    _records = 0;
+    _crc_errors = 0;
+    _lost = 0;
+    memset(&_record, 0x0, sizeof(TelemetryRecord));
+}
+
+bool TelemetryDecoder::feed(uint8_t ch) {
+
+    if( _len == 0 && ch != TELEMETRY_SYNC ) return false;
+
+    _buf[_len++] = ch;
+
+    // a record of another size is not supported
+    if( _len == 2 && ch != sizeof(TelemetryRecord) ) {
+        resync();
+        return false;
+    }
+
+    if( _len < sizeof(TelemetryRecord) ) return false;
+
+    uint16_t crc = TELEMETRY_CRC_INIT;
+    for( size_t i = 0; i < sizeof(TelemetryRecord) - sizeof(uint16_t); i++ ) 
+        crc = telemetry_crc_update(crc, _buf[i]);
+
+    TelemetryRecord record;
+    memcpy(&record, _buf, sizeof(TelemetryRecord));
+
+    if( crc != record.crc ) {
+        _crc_errors++;
+        resync();
+        return false;
+    }
+
+    if( _has_record ) 
+        _lost += (uint8_t)( record.seq - _record.seq - 1 );
+
+    _record = record;
+    _has_record = true;
+    _records++;
+    _len = 0;
+
+    return true;
+}
+
+void TelemetryDecoder::resync() {
+    size_t start = 1;
+    while( start < _len && _buf[start] != TELEMETRY_SYNC ) 
+        start++;
+
+    _len -= start;
+    memmove(_buf, _buf + start, _len);
+
+    // the tail may hold a broken size byte as well
+    if( _len >= 2 && _buf[1] != sizeof(TelemetryRecord) ) 
+        resync();
+}
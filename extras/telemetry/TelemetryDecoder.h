@@ -0,0 +1,55 @@
+#ifndef TelemetryDecoder_h
+#define TelemetryDecoder_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../TelemetryRecord.h"
+
+/**
+ * @brief TelemetryDecoder is a host side parser of the binary telemetry pushed by the UPS after the B command.
+ *        Bytes read from the serial port are fed one by one, text responses in between the records are skipped.
+ *        Records are decoded on a little endian host.
+ */
+class TelemetryDecoder {
+    public:
+        TelemetryDecoder() { reset(); };
+
+        // returns true when a record with the valid CRC is complete
+        bool feed(uint8_t ch);
+
+        // last valid record
+        const TelemetryRecord& record() const { return _record; };
+
+        // scaled values of the last record
+        float inputVoltage() const { return _record.input_vac / 10.0F; };
+        float outputVoltage() const { return _record.output_vac / 10.0F; };
+        float outputFrequency() const { return _record.output_freq / 100.0F; };
+        float outputCurrent() const { return _record.output_ac / 1000.0F; };
+        float batteryVoltage() const { return _record.battery_v / 1000.0F; };
+        float batteryCurrent() const { return _record.battery_c / 1000.0F; };
+
+        unsigned long getRecords() const { return _records; };
+        unsigned long getCrcErrors() const { return _crc_errors; };
+
+        // number of records dropped by the UPS, counted by the gaps of the sequence
+        unsigned long getLost() const { return _lost; };
+
+        void reset();
+
+    private:
+        uint8_t _buf[sizeof(TelemetryRecord)];
+        size_t _len;
+
+        TelemetryRecord _record;
+        bool _has_record;
+
+        unsigned long _records;
+        unsigned long _crc_errors;
+        unsigned long _lost;
+
+        // drop the first byte and look for the next sync in the buffer
+        void resync();
+};
+
+#endif
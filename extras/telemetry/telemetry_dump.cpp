@@ -0,0 +1,30 @@
+// Prints the telemetry records read from stdin as CSV, e.g.
+//   stty -F /dev/ttyUSB0 9600 raw && (printf 'B02\r' > /dev/ttyUSB0; ./telemetry_dump < /dev/ttyUSB0)
+
+#include <stdio.h>
+
+#include "TelemetryDecoder.h"
+
+int main() {
+    TelemetryDecoder decoder;
+
+    printf("seq,status,charger,input_vac,output_vac,output_freq,output_ac,battery_v,battery_c,level,remaining_min\n");
+
+    int ch;
+    while( ( ch = getchar() ) != EOF ) {
+        if( !decoder.feed( (uint8_t) ch ) ) continue;
+
+        const TelemetryRecord& r = decoder.record();
+        printf("%u,%u,%u,%.1f,%.1f,%.2f,%.3f,%.3f,%.3f,%u,%d\n",
+               r.seq, r.status, r.charger_mode,
+               decoder.inputVoltage(), decoder.outputVoltage(), decoder.outputFrequency(),
+               decoder.outputCurrent(), decoder.batteryVoltage(), decoder.batteryCurrent(),
+               r.battery_level, r.remaining_min);
+        fflush(stdout);
+    }
+
+    fprintf(stderr, "records: %lu, CRC errors: %lu, lost: %lu\n", 
+            decoder.getRecords(), decoder.getCrcErrors(), decoder.getLost());
+
+    return 0;
+}
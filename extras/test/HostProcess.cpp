@@ -0,0 +1,155 @@
+#include "HostProcess.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define HOST_MAX_OPTIONS    16
+
+bool HostProcess::start(const char* path, const char* const* options, bool pty) {
+    int in[2], out[2];
+    if( pipe(in) || pipe(out) ) return false;
+
+    const char* argv[HOST_MAX_OPTIONS + 3];
+    int argc = 0;
+    argv[argc++] = path;
+    if( pty ) argv[argc++] = "-p";
+    while( options && *options && argc < HOST_MAX_OPTIONS + 1 ) argv[argc++] = *options++;
+    argv[argc] = nullptr;
+
+    _pid = fork();
+    if( _pid < 0 ) return false;
+
+    if( !_pid ) {
+        // the serial port on stdin/stdout, the name of the pseudo terminal on stderr
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], pty ? STDERR_FILENO : STDOUT_FILENO);
+        close(in[0]); close(in[1]); close(out[0]); close(out[1]);
+        execv(path, (char* const*) argv);
+        _exit(127);
+    }
+
+    close(in[0]);
+    close(out[1]);
+
+    if( !pty ) {
+        _fd = out[0];
+        // stdin of the program stays open till the stop, the output is read from the pipe
+        fcntl(in[1], F_SETFD, FD_CLOEXEC);
+        _stdin = in[1];
+        return true;
+    }
+
+    close(in[1]);
+    _fd = out[0];
+
+    // "serial port: /dev/pts/N"
+    char line[64];
+    bool found = readLine(line, sizeof(line), 2000);
+    close(_fd);
+    _fd = -1;
+
+    const char* name = found ? strchr(line, '/') : nullptr;
+    if( !name ) return false;
+
+    _fd = open(name, O_RDWR | O_NOCTTY);
+    if( _fd < 0 ) return false;
+
+    struct termios tio;
+    tcgetattr(_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(_fd, TCSANOW, &tio);
+
+    return true;
+}
+
+void HostProcess::stop() {
+    if( _pid > 0 ) {
+        kill(_pid, SIGKILL);
+        waitpid(_pid, nullptr, 0);
+        _pid = -1;
+    }
+    if( _fd >= 0 ) close(_fd);
+    if( _stdin >= 0 ) close(_stdin);
+    _fd = _stdin = -1;
+}
+
+int HostProcess::wait() {
+    int status;
+    if( _pid <= 0 || waitpid(_pid, &status, 0) != _pid ) return -1;
+    _pid = -1;
+    stop();
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+bool HostProcess::write(const void* data, size_t len) {
+    int fd = _stdin >= 0 ? _stdin : _fd;
+    return fd >= 0 && ::write(fd, data, len) == (ssize_t) len;
+}
+
+bool HostProcess::wait_input(int timeout_ms) {
+    struct pollfd pfd = { _fd, POLLIN, 0 };
+    return poll(&pfd, 1, timeout_ms) > 0 && ( pfd.revents & POLLIN );
+}
+
+size_t HostProcess::read(void* data, size_t len, int timeout_ms) {
+    uint8_t* buf = (uint8_t*) data;
+    size_t n = 0;
+    while( n < len && wait_input(timeout_ms) ) {
+        ssize_t r = ::read(_fd, buf + n, len - n);
+        if( r <= 0 ) break;
+        n += r;
+    }
+    return n;
+}
+
+bool HostProcess::readLine(char* line, size_t size, int timeout_ms) {
+    size_t n = 0;
+    char ch;
+    while( read(&ch, 1, timeout_ms) == 1 ) {
+        if( ch == '\r' ) continue;
+        if( ch == '\n' ) {
+            line[n] = '\0';
+            return true;
+        }
+        if( n < size - 1 ) line[n++] = ch;
+    }
+    line[n] = '\0';
+    return false;
+}
+
+void HostProcess::drain() {
+    char buf[64];
+    while( read(buf, sizeof(buf), 50) ) {}
+}
+
+bool HostProcess::query(const char* command, char* response, size_t size, int timeout_ms) {
+    drain();
+    if( !write(command, strlen(command)) || !write("\r", 1) ) return false;
+    return readLine(response, size, timeout_ms);
+}
+
+bool host_prepare_eeprom(const char* path, char* eeprom, size_t size) {
+    snprintf(eeprom, size, "/tmp/upscore_eeprom_XXXXXX");
+    int fd = mkstemp(eeprom);
+    if( fd < 0 ) return false;
+    close(fd);
+    unlink(eeprom);
+
+    const char* options[] = { "-e", eeprom, "-t", "2", nullptr };
+    HostProcess host;
+    return host.start(path, options) && host.wait() == 0;
+}
+
+void host_sleep(int ms) {
+    struct timespec ts = { ms / 1000, ( ms % 1000 ) * 1000000L };
+    nanosleep(&ts, nullptr);
+}
@@ -0,0 +1,55 @@
+#ifndef HostProcess_h
+#define HostProcess_h
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @brief HostProcess runs the host build of the firmware (upscore_host) as a child process and talks to
+ *        its serial port, either by the pipes of stdin/stdout or by the pseudo terminal opened with -p.
+ *        Used by the tests which check the firmware end to end against the simulated UPS.
+ */
+class HostProcess {
+    public:
+        ~HostProcess() { stop(); };
+
+        // start the program with the options, the serial port is on a pseudo terminal if pty is set.
+        // The EEPROM file, if any, is passed in the options by -e.
+        bool start(const char* path, const char* const* options, bool pty = false);
+
+        // kill the program and wait for its exit
+        void stop();
+
+        // wait for the exit of the program started with -t, returns the exit status or -1
+        int wait();
+
+        bool write(const void* data, size_t len);
+
+        // read up to len bytes, waiting for each of them up to timeout_ms
+        size_t read(void* data, size_t len, int timeout_ms);
+
+        // read a line terminated by '\n' with the '\r' stripped, false on the timeout
+        bool readLine(char* line, size_t size, int timeout_ms);
+
+        // discard the input received so far
+        void drain();
+
+        // send the command terminated by '\r' and read the first line of its response
+        bool query(const char* command, char* response, size_t size, int timeout_ms = 1000);
+
+    private:
+        pid_t _pid = -1;
+        int _fd = -1;       // the serial port, read and written on the pseudo terminal
+        int _stdin = -1;    // stdin of the program, written instead of the pipe of stdout
+
+        bool wait_input(int timeout_ms);
+};
+
+// a file for the EEPROM of the host build, erased and then initialized by a short first run,
+// so the saved params are applied from the start like on a configured UPS. Returns false on the error.
+bool host_prepare_eeprom(const char* path, char* eeprom, size_t size);
+
+// sleep for the milliseconds
+void host_sleep(int ms);
+
+#endif
@@ -0,0 +1,109 @@
+// Runs the relay autotuning of the charger PID (V5A) against the plant model of the host build and checks
+// the resulting gains, their regulation and that they are saved, e.g.
+//   build/autotune_test build/upscore_host
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "HostProcess.h"
+#include "Charger.h"
+
+#define AUTOTUNE_TEST_BOOT_MS       4000    // the sensors settle and the UPS switches to the mains
+#define AUTOTUNE_TEST_POLL_MS       250
+#define AUTOTUNE_TEST_SETTLE_MS     5000    // the current settles with the new gains
+#define AUTOTUNE_TEST_TOLERANCE     0.05F   // of the charging current
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if( condition ) return;
+    printf("FAILED: %s\n", what);
+    failures++;
+}
+
+// V5: charging, mode, current, voltage, battery current, ...
+static bool read_charger(HostProcess& host, int* mode, float* current, float* reading) {
+    char response[128];
+    int charging;
+    float voltage;
+    return host.query("V5", response, sizeof(response)) &&
+           sscanf(response, "#%d %d %f %f %f", &charging, mode, current, &voltage, reading) == 5;
+}
+
+// V5P3V0 sets the bias to its default 0 and responds with the gains
+static bool read_gains(HostProcess& host, float* kp, float* ki, float* kd) {
+    char response[128];
+    return host.query("V5P3V0", response, sizeof(response)) &&
+           sscanf(response, "(%f %f %f", kp, ki, kd) == 3;
+}
+
+int main(int argc, char** argv) {
+    if( argc < 2 ) {
+        fprintf(stderr, "usage: %s upscore_host\n", argv[0]);
+        return 2;
+    }
+
+    char eeprom[32];
+    if( !host_prepare_eeprom(argv[1], eeprom, sizeof(eeprom)) ) {
+        perror("upscore_host");
+        return 2;
+    }
+
+    const char* options[] = { "-e", eeprom, nullptr };
+    HostProcess host;
+    if( !host.start(argv[1], options) ) {
+        perror("upscore_host");
+        return 2;
+    }
+
+    // the autotuning needs the load connected, the charger is started 3 seconds after it
+    int mode = -1;
+    float current = 0.0F, reading = 0.0F;
+    host_sleep(AUTOTUNE_TEST_BOOT_MS);
+    for( unsigned long t = 0; t < AUTOTUNE_TEST_BOOT_MS && !( mode >= CHARGING_BY_CC && mode <= CHARGING_COMPLETE ); t += AUTOTUNE_TEST_POLL_MS ) {
+        if( !read_charger(host, &mode, &current, &reading) ) mode = -1;
+        host_sleep(AUTOTUNE_TEST_POLL_MS);
+    }
+    check(mode >= CHARGING_BY_CC && mode <= CHARGING_COMPLETE, "charging on the mains");
+
+    host.drain();
+    host.write("V5A\r", 4);
+
+    mode = CHARGING_AUTOTUNE;
+    for( unsigned long t = 0; t < CHARGER_AUTOTUNE_TIMEOUT + TIMER_ONE_SEC && mode == CHARGING_AUTOTUNE; t += AUTOTUNE_TEST_POLL_MS ) {
+        host_sleep(AUTOTUNE_TEST_POLL_MS);
+        if( !read_charger(host, &mode, &current, &reading) ) mode = -1;
+    }
+
+    printf("mode after the autotuning: %d\n", mode);
+    check(mode == CHARGING_BY_CC, "charging by the profile after the autotuning");
+
+    float kp = 0, ki = 0, kd = 0;
+    check(read_gains(host, &kp, &ki, &kd), "gains read");
+    printf("Kp %.2f, Ki %.4f, Kd %.2f\n", kp, ki, kd);
+    check(kp > 0.0F && kp <= PID_MAX_KP, "Kp in the range of the PID");
+    check(ki > 0.0F && ki <= PID_MAX_KI, "Ki in the range of the PID");
+    check(kd > 0.0F && kd <= PID_MAX_KD, "Kd in the range of the PID");
+
+    host_sleep(AUTOTUNE_TEST_SETTLE_MS);
+    check(read_charger(host, &mode, &current, &reading), "charger read");
+    printf("charging current %.2f, battery current %.2f\n", current, reading);
+    check(current > 0.0F && fabs(reading - current) <= AUTOTUNE_TEST_TOLERANCE * current, "battery current regulated to the charging current");
+
+    // the gains are saved by the main loop and loaded on the next start
+    host.stop();
+    check(host.start(argv[1], options), "restarted");
+    host_sleep(AUTOTUNE_TEST_BOOT_MS);
+
+    float saved_kp = 0, saved_ki = 0, saved_kd = 0;
+    check(read_gains(host, &saved_kp, &saved_ki, &saved_kd), "saved gains read");
+    check(fabs(saved_kp - kp) < 0.01F && fabs(saved_ki - ki) < 0.01F && fabs(saved_kd - kd) < 0.01F, "gains saved in the EEPROM");
+
+    host.stop();
+    unlink(eeprom);
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
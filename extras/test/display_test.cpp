@@ -0,0 +1,152 @@
+// Renders a known state of the UPS by the Display of the type it is built for and compares the frame captured by
+// the virtual backend with the golden one: the sensors sample the synthetic mains and battery, the UPS is on the
+// mains with the relays connected, e.g.
+//   build/display_lcd_test
+//   build/display_led_test
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "Display.h"
+
+#ifdef DISPLAY_TYPE_LED_TM1640
+#include "VirtualTM1640.h"
+#endif
+
+#define DISPLAY_TEST_TICKS      3000    // the windows are filled and the input is stable for 2 sec
+#define DISPLAY_TEST_PASSES     200     // loop passes flushing the frame
+
+// the ADC of the known state: 50Hz sines around the median for the AC voltages, the constants for the others
+#define DISPLAY_TEST_FREQ       50
+#define DISPLAY_TEST_VAC_IN     300     // amplitude, 230.5V by the scale below
+#define DISPLAY_TEST_VAC_OUT    290     // 221.6V
+#define DISPLAY_TEST_AC_OUT     300     // 2.1A, 53% of the load
+#define DISPLAY_TEST_V_BAT      512     // 27.12V
+#define DISPLAY_TEST_C_BAT      518     // 0.52A
+
+// the sensors of the sketch, the AC ones scaled to the amplitude above
+RMSSensor vac_in(SENSOR_INPUT_VAC_IN, 0.0F, 1.0866F, 80, 1, 0, 3);
+RMSSensor vac_out(SENSOR_OUTPUT_VAC_IN, 0.0F, 1.0806F, 80, 1, 0, 3);
+SimpleSensor ac_out(SENSOR_OUTPUT_C_IN, 0.0F, 0.007, 20, 5, 2 );
+SimpleSensor v_bat(SENSOR_BAT_V_IN, 0.0F, 0.05298, 20, 5 ,3 );
+SimpleSensor c_bat(SENSOR_BAT_C_IN, -37.61F, 0.07362F, 20, 5, 4 );
+
+Settings settings;
+Charger charger(&settings, &c_bat, &v_bat);
+Interactive lineups( &vac_in, &vac_out, &ac_out, &v_bat);
+Display display(&lineups, &charger, &vac_in, &vac_out, &ac_out, &v_bat, &c_bat);
+
+#ifdef DISPLAY_TYPE_LCD_HD44780
+static const char GOLDEN[] =
+    "I: 230V, 50.0Hz  OK \n"
+    "O: 221V, 50.0Hz  OK \n"
+    "B:  27.12V,  0.52A  \n"
+    "C: 99% L: 53% 09  0 \n";
+#else
+// the grids of the input and the output voltages, the level segments, the indicators and the relays
+static const uint8_t GOLDEN[] = {
+    0xBD, 0x9E, 0xFB, 0xBD, 0xBC, 0xBD, 0x0D, 0xBF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+#endif
+
+static unsigned long tick = 0;
+
+int analogRead(uint8_t pin) {
+    float phase = 2 * M_PI * DISPLAY_TEST_FREQ * tick / TIMER_ONE_SEC;
+
+    switch( pin ) {
+        case SENSOR_INPUT_VAC_IN: return SENSOR_MEDIAN_READING + lround( DISPLAY_TEST_VAC_IN * sin(phase) );
+        case SENSOR_OUTPUT_VAC_IN: return SENSOR_MEDIAN_READING + lround( DISPLAY_TEST_VAC_OUT * sin(phase) );
+        case SENSOR_OUTPUT_C_IN: return DISPLAY_TEST_AC_OUT;
+        case SENSOR_BAT_V_IN: return DISPLAY_TEST_V_BAT;
+        case SENSOR_BAT_C_IN: return DISPLAY_TEST_C_BAT;
+    }
+    return 0;
+}
+
+// the relays and the charger output are not read back
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+void hal_pwm_write(uint16_t) {}
+void hal_sleep(uint32_t) {}
+
+// the sensors are sampled by the test, not by the timer interrupt
+void hal_cli() {}
+void hal_sei() {}
+bool hal_interrupts_enabled() { return false; }
+
+unsigned long micros() { return tick * 1000UL; }
+unsigned long millis() { return tick; }
+
+// the settings are not loaded
+bool eeprom_is_ready() { return true; }
+uint8_t eeprom_read_byte(const uint8_t*) { return 0xFF; }
+void eeprom_write_byte(uint8_t*, uint8_t) {}
+void eeprom_update_byte(uint8_t*, uint8_t) {}
+void eeprom_read_block(void* dst, const void*, size_t n) { memset(dst, 0xFF, n); }
+void eeprom_update_block(const void*, void*, size_t) {}
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if( condition ) return;
+    printf("FAILED: %s\n", what);
+    failures++;
+}
+
+int main() {
+    Sensor* sensors[] = { &vac_in, &vac_out, &ac_out, &v_bat, &c_bat };
+
+    // the params are applied as by the load of the settings, the median of the AC sensors is set by the offset
+    for( Sensor* sensor : sensors ) {
+        sensor->setParam(sensor->getParam(SENSOR_PARAM_OFFSET), SENSOR_PARAM_OFFSET);
+        sensor->setParam(sensor->getParam(SENSOR_PARAM_SCALE), SENSOR_PARAM_SCALE);
+    }
+
+    for( tick = 1; tick <= DISPLAY_TEST_TICKS; tick++ )
+        for( Sensor* sensor : sensors ) sensor->sample();
+
+    for( Sensor* sensor : sensors ) sensor->compute_reading();
+
+    // on the mains with the load connected, as the sketch does on REGULATE_STATUS_SUCCESS
+    lineups.regulate(tick);
+    lineups.toggleInput(true);
+    lineups.toggleOutput(true);
+    lineups.regulate(tick);
+
+    printf("input %.2fV %.2fHz, output %.2fV, load %.2fA, battery %.2fV %.2fA, status %04X\n",
+           vac_in.reading(), vac_in.get_frequency(), vac_out.reading(), ac_out.reading(),
+           v_bat.reading(), c_bat.reading(), lineups.getStatus());
+
+    display.initialize();
+    display.update();
+    for( int n = 0; n < DISPLAY_TEST_PASSES; n++ ) display.refresh();
+
+#ifdef DISPLAY_TYPE_LCD_HD44780
+    printf("%s", display.frame());
+    check(display.matches(GOLDEN), "golden frame");
+    check(display.isOn() && display.isBacklight(), "display on");
+
+    // the row continues in the DDRAM: the row 2 in the row 1, the row 1 in the row 3 and the row 3 in the row 0
+    display.clear();
+    display.setCursor(18, 2);
+    display.print("WXYZ");
+    display.setCursor(18, 3);
+    display.print("ab");
+    display.print("cd");
+    check(display.matches(
+        "cd                  \n"
+        "YZ                  \n"
+        "                  WX\n"
+        "                  ab\n"), "DDRAM wrapped to the next line");
+#else
+    printf("%s\n", virtual_tm1640.frame());
+    check(virtual_tm1640.matches(GOLDEN, sizeof(GOLDEN)), "golden frame");
+    check(virtual_tm1640.isOn(), "display on");
+#endif
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
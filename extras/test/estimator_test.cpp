@@ -0,0 +1,105 @@
+// Feeds the runtime estimator with the battery current of an outage, sampled window by window as by the loop:
+// the noisy one, with the single idle windows and a short idle run in it, must stay one discharge event with
+// one fit of the Peukert exponent, the same as of the clean one, e.g.
+//   build/estimator_test
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Estimator.h"
+
+#define ESTIMATOR_TEST_WINDOW   100     // ticks per the window of the battery current sensor
+#define ESTIMATOR_TEST_LOAD     3.0F    // discharge current, Amps
+#define ESTIMATOR_TEST_CAP      13.5F   // capacity delivered at the load, AH, fits the exponent to 1.24
+#define ESTIMATOR_TEST_DROP     0.4F    // drop of the level over the outage
+#define ESTIMATOR_TEST_LSB      0.07362F    // step of the battery current ADC, Amps
+#define ESTIMATOR_TEST_GLITCH   500     // a window of the outage out of this many reads no current
+#define ESTIMATOR_TEST_MAINS    30      // idle windows after the mains is back, before the charger starts
+
+// the settings are kept in the memory
+static uint8_t eeprom[1024];
+
+bool eeprom_is_ready() { return true; }
+uint8_t eeprom_read_byte(const uint8_t* addr) { return eeprom[(intptr_t) addr]; }
+void eeprom_write_byte(uint8_t* addr, uint8_t value) { eeprom[(intptr_t) addr] = value; }
+void eeprom_update_byte(uint8_t* addr, uint8_t value) { eeprom[(intptr_t) addr] = value; }
+void eeprom_read_block(void* dst, const void* src, size_t n) { memcpy(dst, eeprom + (intptr_t) src, n); }
+void eeprom_update_block(const void* src, void* dst, size_t n) { memcpy(eeprom + (intptr_t) dst, src, n); }
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if( condition ) return;
+    printf("FAILED: %s\n", what);
+    failures++;
+}
+
+// the current as measured by the ADC, to its step
+static float measured(float current) {
+    return round( current / ESTIMATOR_TEST_LSB ) * ESTIMATOR_TEST_LSB;
+}
+
+// runs the outage through the estimator, returns the windows of the outage it was not discharging in
+static long outage(RuntimeEstimator* estimator, bool noisy) {
+    long windows = lround( ESTIMATOR_TEST_CAP * ESTIMATOR_TEST_DROP / ESTIMATOR_TEST_LOAD * ESTIMATOR_TICKS_PER_HOUR / ESTIMATOR_TEST_WINDOW );
+    unsigned long ticks = 0;
+    float level = 1.0F;
+    long missed = 0;
+
+    srand(1);
+    for( long i = 1; i <= windows; i++ ) {
+        float current = -ESTIMATOR_TEST_LOAD;
+        if( noisy ) {
+            current += ( rand() % 5 - 2 ) * ESTIMATOR_TEST_LSB;
+            // the load drops out for a window or for 5 windows in the middle of the outage
+            if( i % ESTIMATOR_TEST_GLITCH == 0 || ( i >= windows / 2 && i < windows / 2 + 5 ) ) current = rand() % 2 * ESTIMATOR_TEST_LSB;
+        }
+
+        ticks += ESTIMATOR_TEST_WINDOW;
+        level = 1.0F - ESTIMATOR_TEST_DROP * i / windows;
+        estimator->update(measured(current), level, ticks);
+        if( !estimator->is_discharging() ) missed++;
+    }
+
+    // the mains is back, the charger starts later and raises the level
+    for( int i = 0; i < ESTIMATOR_TEST_MAINS; i++ ) {
+        ticks += ESTIMATOR_TEST_WINDOW;
+        estimator->update(measured(noisy ? ESTIMATOR_TEST_LSB : 0.0F), level, ticks);
+    }
+    ticks += ESTIMATOR_TEST_WINDOW;
+    estimator->update(measured(1.0F), level + 0.01F, ticks);
+
+    return missed;
+}
+
+int main() {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+
+    Settings settings;
+    settings.begin();
+
+    RuntimeEstimator clean(&settings, ESTIMATOR_TEST_WINDOW);
+    clean.loadParams();
+    check(outage(&clean, false) == 0, "clean outage discharging");
+    check(clean.get_events() == 1, "clean outage is one event");
+    float fitted = clean.getParam(ESTIMATOR_PEUKERT);
+
+    RuntimeEstimator noisy(&settings, ESTIMATOR_TEST_WINDOW);
+    noisy.setParam(INTERACTIVE_BATTERY_PEUKERT, ESTIMATOR_PEUKERT);
+    long missed = outage(&noisy, true);
+    float peukert = noisy.getParam(ESTIMATOR_PEUKERT);
+
+    printf("Peukert %.4f, fitted %.4f clean, %.4f noisy, %u events, %ld windows missed\n",
+           INTERACTIVE_BATTERY_PEUKERT, fitted, peukert, noisy.get_events(), missed);
+
+    check(fitted > INTERACTIVE_BATTERY_PEUKERT + 0.01F, "clean outage fitted");
+    check(missed == 0, "noisy outage discharging");
+    check(noisy.get_events() == 1, "noisy outage is one event");
+    check(fabs(peukert - fitted) < 0.002F, "noisy outage fitted once as the clean one");
+    check(!noisy.is_discharging() && noisy.get_remaining_minutes() < 0, "charging after the outage");
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
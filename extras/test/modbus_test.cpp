@@ -0,0 +1,191 @@
+// Talks to the host build as a Modbus RTU master over its pseudo terminal: switches the port by M2, checks
+// the functions 01, 03, 04, 05, 06 and 16, the CRC of the responses and the exception replies, e.g.
+//   build/modbus_test build/upscore_host
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "HostProcess.h"
+#include "config.h"
+
+#define MODBUS_TEST_BOOT_MS     3000
+#define MODBUS_TEST_TIMEOUT_MS  500     // the response of 70 bytes takes 73ms at 9600bps
+#define MODBUS_TEST_GAP_MS      50      // silence between the requests
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if( condition ) return;
+    printf("FAILED: %s\n", what);
+    failures++;
+}
+
+// CRC-16/MODBUS, computed bitwise to check the table of the firmware
+static uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    while( len-- ) {
+        crc ^= *data++;
+        for( int i = 0; i < 8; i++ )
+            crc = ( crc & 0x0001 ) ? ( crc >> 1 ) ^ 0xA001 : crc >> 1;
+    }
+    return crc;
+}
+
+// send the request with its CRC and read the response of the expected length, 0 if there is none.
+// Returns the length of the response with the valid CRC
+static size_t transact(HostProcess& host, const uint8_t* request, size_t len, uint8_t* response, size_t expected) {
+    uint8_t frame[80];
+    memcpy(frame, request, len);
+    uint16_t crc = crc16(request, len);
+    frame[len++] = crc & 0xFF;
+    frame[len++] = crc >> 8;
+
+    host_sleep(MODBUS_TEST_GAP_MS);
+    host.drain();
+    host.write(frame, len);
+
+    // an exception is 5 bytes, read them first to not wait for the rest
+    size_t n = host.read(response, 5, MODBUS_TEST_TIMEOUT_MS);
+    if( n == 5 && !( response[1] & 0x80 ) && expected > 5 )
+        n += host.read(response + 5, expected - 5, MODBUS_TEST_TIMEOUT_MS);
+
+    if( n < 5 || crc16(response, n) ) return 0;
+    return n;
+}
+
+static bool exception(const uint8_t* response, size_t n, uint8_t function, uint8_t code) {
+    return n == 5 && response[0] == MODBUS_SLAVE_ADDRESS && response[1] == ( function | 0x80 ) && response[2] == code;
+}
+
+static uint16_t reg(const uint8_t* response, int index) {
+    return ( response[3 + 2 * index] << 8 ) | response[4 + 2 * index];
+}
+
+int main(int argc, char** argv) {
+    if( argc < 2 ) {
+        fprintf(stderr, "usage: %s upscore_host\n", argv[0]);
+        return 2;
+    }
+
+    char eeprom[32];
+    if( !host_prepare_eeprom(argv[1], eeprom, sizeof(eeprom)) ) {
+        perror("upscore_host");
+        return 2;
+    }
+
+    const char* options[] = { "-e", eeprom, nullptr };
+    HostProcess host;
+    if( !host.start(argv[1], options, true) ) {
+        perror("upscore_host");
+        return 2;
+    }
+
+    host_sleep(MODBUS_TEST_BOOT_MS);
+
+    char line[64];
+    check(host.query("M2", line, sizeof(line)) && !strcmp(line, "#R"), "switched to Modbus by M2");
+
+    const uint8_t addr = MODBUS_SLAVE_ADDRESS;
+    uint8_t response[80];
+    size_t n;
+
+    // 04: the input registers, voltages x10, the status words
+    const uint8_t read_inputs[] = { addr, 0x04, 0x00, 0x00, 0x00, 0x0D };
+    n = transact(host, read_inputs, sizeof(read_inputs), response, 5 + 2 * 13);
+    check(n == 31 && response[1] == 0x04 && response[2] == 26, "04 read input registers");
+    printf("input %.1fV, output %.1fV %.1fHz, battery %.2fV, status %02X\n",
+           reg(response, 0) / 10.0, reg(response, 3) / 10.0, reg(response, 4) / 10.0, reg(response, 7) / 100.0, reg(response, 11));
+    check(reg(response, 0) > 2000 && reg(response, 0) < 2500, "04 input voltage on the mains");
+
+    // 03: the holding registers, the dialect is 2 (Modbus)
+    const uint8_t read_holding[] = { addr, 0x03, 0x00, 0x00, 0x00, 0x05 };
+    n = transact(host, read_holding, sizeof(read_holding), response, 5 + 2 * 5);
+    check(n == 15 && response[1] == 0x03 && response[2] == 10 && reg(response, 3) == 2, "03 read holding registers");
+
+    // 06: the shutdown delay x10 is written and read back
+    const uint8_t write_delay[] = { addr, 0x06, 0x00, 0x01, 0x00, 0x32 };
+    n = transact(host, write_delay, sizeof(write_delay), response, 8);
+    check(n == 8 && !memcmp(response, write_delay, sizeof(write_delay)), "06 write single register echoed");
+    const uint8_t read_delay[] = { addr, 0x03, 0x00, 0x01, 0x00, 0x01 };
+    n = transact(host, read_delay, sizeof(read_delay), response, 7);
+    check(n == 7 && reg(response, 0) == 50, "06 written register read back");
+
+    // 16: the range ending out of the holding registers is rejected before any of them is written,
+    // the dialect and the charge profile are kept
+    n = transact(host, read_holding, sizeof(read_holding), response, 5 + 2 * 5);
+    uint16_t profile = reg(response, 4);
+    const uint8_t write_partial[] = { addr, 0x10, 0x00, 0x00, 0x00, 0x06, 0x0C,
+                                      0x00, 0x14, 0x00, 0x64, 0x00, 0x05, 0x00, 0x00, 0x00, (uint8_t) !profile, 0x00, 0x00 };
+    n = transact(host, write_partial, sizeof(write_partial), response, 8);
+    check(exception(response, n, 0x10, 0x02), "16 partial range rejected");
+    n = transact(host, read_holding, sizeof(read_holding), response, 5 + 2 * 5);
+    check(n == 15 && reg(response, 1) == 50 && reg(response, 3) == 2 && reg(response, 4) == profile,
+          "16 partial range not written");
+
+    // 16: the float Kd of the charger (0x100 + 16 * 5 + 2 * 2) as a pair of the registers, high word first
+    const uint8_t write_kd[] = { addr, 0x10, 0x01, 0x54, 0x00, 0x02, 0x04, 0x42, 0x70, 0x00, 0x00 };    // 60.0
+    n = transact(host, write_kd, sizeof(write_kd), response, 8);
+    check(n == 8 && !memcmp(response, write_kd, 6), "16 write float param");
+    const uint8_t read_kd[] = { addr, 0x03, 0x01, 0x54, 0x00, 0x02 };
+    n = transact(host, read_kd, sizeof(read_kd), response, 9);
+    check(n == 9 && reg(response, 0) == 0x4270 && reg(response, 1) == 0x0000, "16 written float read back");
+
+    // a half of the float param is rejected
+    const uint8_t write_half[] = { addr, 0x06, 0x01, 0x54, 0x42, 0x48 };
+    n = transact(host, write_half, sizeof(write_half), response, 8);
+    check(exception(response, n, 0x06, 0x02), "06 to a float half rejected");
+    const uint8_t write_odd[] = { addr, 0x10, 0x01, 0x55, 0x00, 0x02, 0x04, 0x00, 0x00, 0x42, 0x48 };
+    n = transact(host, write_odd, sizeof(write_odd), response, 8);
+    check(exception(response, n, 0x10, 0x02), "16 at an odd float register rejected");
+    n = transact(host, read_kd, sizeof(read_kd), response, 9);
+    check(n == 9 && reg(response, 0) == 0x4270 && reg(response, 1) == 0x0000, "float kept after the rejected writes");
+
+    // 05 and 01: the self-test coil starts the test, its status is read back
+    const uint8_t test_on[] = { addr, 0x05, 0x00, 0x01, 0xFF, 0x00 };
+    n = transact(host, test_on, sizeof(test_on), response, 8);
+    check(n == 8 && !memcmp(response, test_on, sizeof(test_on)), "05 write coil echoed");
+    host_sleep(500);
+    const uint8_t read_coils[] = { addr, 0x01, 0x00, 0x00, 0x00, 0x05 };
+    n = transact(host, read_coils, sizeof(read_coils), response, 6);
+    check(n == 6 && response[1] == 0x01 && response[2] == 1 && ( response[3] & 0x02 ), "01 self-test coil set");
+    const uint8_t test_off[] = { addr, 0x05, 0x00, 0x01, 0x00, 0x00 };
+    n = transact(host, test_off, sizeof(test_off), response, 8);
+    check(n == 8 && !memcmp(response, test_off, sizeof(test_off)), "05 coil cleared");
+    const uint8_t bad_coil[] = { addr, 0x05, 0x00, 0x01, 0x12, 0x34 };
+    n = transact(host, bad_coil, sizeof(bad_coil), response, 8);
+    check(exception(response, n, 0x05, 0x03), "05 illegal value");
+
+    // exceptions
+    const uint8_t bad_function[] = { addr, 0x07, 0x00, 0x00, 0x00, 0x01 };
+    n = transact(host, bad_function, sizeof(bad_function), response, 5);
+    check(exception(response, n, 0x07, 0x01), "illegal function");
+    const uint8_t bad_input[] = { addr, 0x04, 0x00, 0x64, 0x00, 0x01 };
+    n = transact(host, bad_input, sizeof(bad_input), response, 7);
+    check(exception(response, n, 0x04, 0x02), "04 illegal address");
+    const uint8_t bad_count[] = { addr, 0x03, 0x00, 0x00, 0x00, 0x00 };
+    n = transact(host, bad_count, sizeof(bad_count), response, 7);
+    check(exception(response, n, 0x03, 0x03), "03 illegal count");
+
+    // the frames with a wrong CRC and for other slaves are not answered
+    uint8_t frame[8] = { addr, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00 };
+    host_sleep(MODBUS_TEST_GAP_MS);
+    host.drain();
+    host.write(frame, sizeof(frame));
+    check(host.read(response, sizeof(response), MODBUS_TEST_TIMEOUT_MS) == 0, "wrong CRC not answered");
+    const uint8_t other_slave[] = { (uint8_t)( addr + 1 ), 0x03, 0x00, 0x00, 0x00, 0x01 };
+    check(transact(host, other_slave, sizeof(other_slave), response, 7) == 0, "other slave not answered");
+
+    // 06 to the dialect switches back to the text protocol
+    const uint8_t to_voltronic[] = { addr, 0x06, 0x00, 0x03, 0x00, 0x00 };
+    n = transact(host, to_voltronic, sizeof(to_voltronic), response, 8);
+    check(n == 8 && !memcmp(response, to_voltronic, sizeof(to_voltronic)), "06 dialect echoed");
+    host_sleep(MODBUS_TEST_GAP_MS);
+    check(host.query("M", line, sizeof(line)) && !strcmp(line, "#V"), "back to Voltronic");
+
+    host.stop();
+    unlink(eeprom);
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+// Compares ex_parse_fixed() with strtod() on the edge cases and on random inputs of the digits, dots, signs
+// and terminators: the status, the symbols consumed and the value, truncated to EX_MAX_DECIMALS, e.g.
+//   build/parse_fixed_test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "utilities.h"
+
+// the largest integer part accepted, its digits up to the last one must stay below ( INT32_MAX - 9 ) / 10
+#define PARSE_TEST_MAX_INTEGER  ( ( INT32_MAX - 9 ) / 10 * 10 + 9 )
+
+#define PARSE_TEST_RANDOM       1000000
+#define PARSE_TEST_MAX_LEN      24
+
+static int failures = 0;
+
+static void check(bool condition, const char* what, const char* input) {
+    if( condition ) return;
+    if( failures++ < 20 ) printf("FAILED: %s '%s'\n", what, input);
+}
+
+static const char* status_name(ExParseStatus status) {
+    return status == EX_PARSE_OK ? "OK" : status == EX_PARSE_EMPTY ? "EMPTY" : "OVERFLOW";
+}
+
+// parses the input at the offset pos with strtod and with ex_parse_fixed and compares them
+static void compare(const char* buf, uint8_t pos, uint8_t len, bool sign) {
+    const char* input = buf + pos;
+
+    // the reference sees the same symbols as the parser
+    char ref[PARSE_TEST_MAX_LEN + 1];
+    size_t n = strnlen(input, len);
+    memcpy(ref, input, n);
+    ref[n] = '\0';
+
+    char* end;
+    double expected = strtod(ref, &end);
+    size_t consumed = end - ref;
+
+    ExParseStatus expected_status = EX_PARSE_OK;
+    if( !consumed || ( !sign && ( ref[0] == '-' || ref[0] == '+' ) ) ) expected_status = EX_PARSE_EMPTY;
+    else if( fabs(expected) >= PARSE_TEST_MAX_INTEGER + 1.0 ) expected_status = EX_PARSE_OVERFLOW;
+
+    ExFixedValue result = { 0x5A5A5A5A, 0xA5 };
+    uint8_t p = pos;
+    ExParseStatus status = ex_parse_fixed(buf, &p, len, sign, &result);
+
+    if( status != expected_status ) {
+        if( failures++ < 20 ) printf("FAILED: '%s' len %d: %s, strtod %s\n", ref, len, status_name(status), status_name(expected_status));
+        return;
+    }
+
+    if( status != EX_PARSE_OK ) {
+        check(p == pos && result.value == 0x5A5A5A5A && result.dec == 0xA5, "untouched on the error", ref);
+        return;
+    }
+
+    check(p == pos + consumed, "symbols consumed as by strtod", ref);
+    check(result.dec <= EX_MAX_DECIMALS, "decimals kept", ref);
+
+    // the dropped decimals truncate the value by less than its last digit
+    double value = result.value / pow(10, result.dec);
+    double error = fabs(expected) - fabs(value);
+    double eps = 1e-12 * ( 1.0 + fabs(expected) );
+    check(error > -eps && error < pow(10, -result.dec) + eps, "value as by strtod", ref);
+    check(!result.value || ( result.value < 0 ) == ( expected < 0 ), "sign", ref);
+}
+
+// the edge cases, parsed with the sign allowed and the length of the input
+static const char* EDGES[] = {
+    "", ".", "-", "+", "-.", "+.", "..", ".5", "5.", "-.5", "+5", "--5", "+-5", "-0", "0.0",
+    "1.2.3", "12,5", "7A", "007", "000.000",
+    "0.123456789", "0.1234567891", "1.99999999999999", "123.4567890123", "0.000000000001",
+    "2147483639", "2147483640", "-2147483639", "-2147483640", "2147483647", "99999999999",
+    "2147483639.99", "214748363.999999999", "214748364.5", "0000000000002147483639"
+};
+
+// digits mostly, the symbols ending the number and no exponent, hex or whitespace skipped by strtod
+static const char SYMBOLS[] = "01234567890123456789..-+,A";
+
+int main() {
+    for( const char* edge : EDGES ) {
+        compare(edge, 0, strlen(edge), true);
+        compare(edge, 0, strlen(edge), false);
+    }
+
+    // the length limit stops the number
+    char buf[PARSE_TEST_MAX_LEN + 1] = "x-123.4567";
+    for( uint8_t len = 0; len <= strlen(buf + 1); len++ ) compare(buf, 1, len, true);
+
+    ExFixedValue result;
+    uint8_t pos = 0;
+    check(ex_parse_fixed("12345", &pos, 3, false, &result) == EX_PARSE_OK && pos == 3 && result.value == 123, "3 of 5 digits", "12345");
+
+    srand(1);
+    for( long i = 0; i < PARSE_TEST_RANDOM; i++ ) {
+        uint8_t n = rand() % PARSE_TEST_MAX_LEN;
+        for( uint8_t j = 0; j < n; j++ ) buf[j] = SYMBOLS[rand() % ( sizeof(SYMBOLS) - 1 )];
+        buf[n] = '\0';
+
+        uint8_t pos = n ? rand() % n : 0;
+        compare(buf, pos, rand() % ( PARSE_TEST_MAX_LEN + 1 ), rand() % 2);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+// Checks the CRC of the telemetry records against the known vectors and decodes a recorded frame
+// with the noise, a broken record and a gap of the sequence around it, e.g.
+//   build/telemetry_decoder_test
+
+#include <stdio.h>
+#include <string.h>
+
+#include <util/crc16.h>
+
+#include "TelemetryDecoder.h"
+
+// CRC-16/CCITT-FALSE check value
+static const char CRC_CHECK_INPUT[] = "123456789";
+static const uint16_t CRC_CHECK_VALUE = 0x29B1;
+
+// seq 7, charging by CC, status 0x0009, input 228.3V, output 221.7V 50.00Hz 1.2A, battery 27.12V -0.35A 97%, 42 min
+static const uint8_t FRAME[] = {
+    0xA5, 0x18, 0x07, 0x01, 0x09, 0x00, 0xEB, 0x08, 0xA9, 0x08, 0x88, 0x13,
+    0xB0, 0x04, 0xF0, 0x69, 0xA2, 0xFE, 0x61, 0x00, 0x2A, 0x00, 0xDF, 0x1E
+};
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if( condition ) return;
+    printf("FAILED: %s\n", what);
+    failures++;
+}
+
+static uint16_t crc_of(const uint8_t* data, size_t len, bool firmware) {
+    uint16_t crc = TELEMETRY_CRC_INIT;
+    for( size_t i = 0; i < len; i++ )
+        crc = firmware ? _crc_xmodem_update(crc, data[i]) : telemetry_crc_update(crc, data[i]);
+    return crc;
+}
+
+// feed the bytes, returns the number of the records decoded
+static int feed(TelemetryDecoder* decoder, const uint8_t* data, size_t len) {
+    int records = 0;
+    for( size_t i = 0; i < len; i++ )
+        if( decoder->feed(data[i]) ) records++;
+    return records;
+}
+
+int main() {
+    static_assert( sizeof(FRAME) == sizeof(TelemetryRecord), "the frame is a record" );
+
+    // the decoder and the firmware compute the same CRC
+    const uint8_t* check_input = (const uint8_t*) CRC_CHECK_INPUT;
+    check(crc_of(check_input, strlen(CRC_CHECK_INPUT), false) == CRC_CHECK_VALUE, "CRC-16/CCITT-FALSE check value of the decoder");
+    check(crc_of(check_input, strlen(CRC_CHECK_INPUT), true) == CRC_CHECK_VALUE, "CRC-16/CCITT-FALSE check value of the firmware");
+
+    TelemetryDecoder decoder;
+
+    // a text response and a stray sync byte before the record
+    const uint8_t text[] = { '(', '2', '2', '8', '.', '3', 0xA5, '\r', '\n' };
+    check(feed(&decoder, text, sizeof(text)) == 0, "text skipped");
+    check(feed(&decoder, FRAME, sizeof(FRAME)) == 1, "frame decoded");
+
+    const TelemetryRecord& r = decoder.record();
+    check(r.seq == 7 && r.charger_mode == 1 && r.status == 0x0009, "header fields");
+    check(decoder.inputVoltage() == 228.3F && decoder.outputVoltage() == 221.7F, "voltages");
+    check(decoder.outputFrequency() == 50.0F && decoder.outputCurrent() == 1.2F, "output");
+    check(decoder.batteryVoltage() == 27.12F && decoder.batteryCurrent() == -0.35F, "battery");
+    check(r.battery_level == 97 && r.remaining_min == 42, "level and runtime");
+
+    // a corrupted record is rejected
+    uint8_t frame[sizeof(FRAME)];
+    memcpy(frame, FRAME, sizeof(FRAME));
+    frame[2] = 8;
+    frame[6] ^= 0x01;
+    check(feed(&decoder, frame, sizeof(frame)) == 0, "corrupted frame rejected");
+    check(decoder.getCrcErrors() == 1, "CRC error counted");
+
+    // the next valid record after 2 dropped ones
+    TelemetryRecord next;
+    memcpy(&next, FRAME, sizeof(FRAME));
+    next.seq = 10;
+    next.crc = crc_of((const uint8_t*) &next, sizeof(TelemetryRecord) - sizeof(uint16_t), true);
+    check(feed(&decoder, (const uint8_t*) &next, sizeof(next)) == 1, "next frame decoded");
+    check(decoder.getRecords() == 2 && decoder.getLost() == 2, "records and gaps counted");
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -1,22 +1,34 @@
 #include "utilities.h"
 
-int get_width_modifier(const char* modifier, int *index); 
-int get_precision_modifier(const char* modifier, int *index);
+// the lowest digit of the value in the base, the value is divided by the base
+static uint8_t ex_divmod(uint32_t* value, uint8_t base) {
+    if( base == DEC ) return ex_divmod10(value);
+
+    uint8_t digit;
+    if( base == HEX ) {
+        digit = *value & 0x0F;
+        *value >>= 4;
+    }
+    else {
+        digit = *value % base;
+        *value /= base;
+    }
+    return digit;
+}
 
 /** prints a number to an existing char buffer passed by ref */
-void ex_print_number_to_buf(char* _buf, float val, int len, int dec, int base, bool unsgn) {
+void ex_print_number_to_buf(char* _buf, long val, int len, int dec, int base, bool unsgn) {
     memset(_buf, 0x0, len + 2);
 
-    int digits = abs(val * pow(10, dec));
+    uint32_t digits = val < 0 ? -val : val;
     bool minus = (val < 0) && !unsgn;
 
     for(int i=0; i < len + (dec?1:0); i++) {
         int index = len - i - (dec?0:1);
         if( digits ||  i <= dec ) {
             if(i != dec || dec == 0 ) {
-                int digit = digits % base;
+                uint8_t digit = ex_divmod(&digits, base);
                 *(_buf + index) = ( digit < 10? 0x30 : 0x37 ) + digit ;
-                digits /= base;
             }
             else {
                 *(_buf + index) = '.';
@@ -36,11 +48,47 @@ void ex_print_number_to_buf(char* _buf, float val, int len, int dec, int base, b
     
 }
 
-void ex_print_number_to_stream(Print* stream, float val, int len, int dec) {
-    char * buf = malloc(len+2);
-    ex_print_number_to_buf(buf, val, len, dec );
-    stream->print(buf);
-    free(buf);
+uint8_t ex_format_fixed(char* buf, long value, uint8_t width, uint8_t dec) {
+    char rev[EX_MAX_NUMBER_LEN + 4];
+    uint8_t n = 0;
+
+    bool minus = value < 0;
+    uint32_t digits = minus ? -value : value;
+
+    // the digits are rendered from the lowest one
+    for( uint8_t i = 0; i < dec && n < EX_MAX_NUMBER_LEN; i++ ) 
+        rev[n++] = '0' + ex_divmod10(&digits);
+
+    if( dec ) rev[n++] = '.';
+
+    do {
+        rev[n++] = '0' + ex_divmod10(&digits);
+    } while( digits && n < EX_MAX_NUMBER_LEN );
+
+    if( minus ) rev[n++] = '-';
+
+    uint8_t len = min( width ? width + ( dec ? 1 : 0 ) : n, EX_MAX_NUMBER_LEN + 1 );
+    if( n > len ) n = len;
+
+    uint8_t pos = 0;
+    while( pos < len - n ) buf[pos++] = ' ';
+    while( n ) buf[pos++] = rev[--n];
+    buf[pos] = '\0';
+
+    return len;
+}
+
+uint32_t ex_to_bcd(uint16_t value) {
+    uint32_t digits = value;
+    uint32_t bcd = 0;
+    for( uint8_t shift = 0; digits; shift += 4 ) 
+        bcd |= (uint32_t) ex_divmod10(&digits) << shift;
+    return bcd;
+}
+
+void ex_print_fixed(Print* stream, long value, uint8_t width, uint8_t dec) {
+    char buf[EX_MAX_NUMBER_LEN + 2];
+    stream->write( buf, ex_format_fixed(buf, value, width, dec) );
 }
 
 void ex_print_binary_to_stream(Print* stream,  uint8_t val) {
@@ -64,108 +112,49 @@ void ex_print_str_to_stream(Print* stream, const char* str, bool pgm, int fix_le
     }
 }
 
-void ex_printf_to_stream(Print* stream, const char* fmt, ...) {
-    va_list args;
-    int wid, prec;
-
-    va_start(args, fmt); 
-
-    for(int index = 0; *(fmt + index) != '\0'; index++) {
-         // read format
-         if(*(fmt + index) == '%') {
-            index++;
-            wid = get_width_modifier(fmt + index, &index);
-            prec = get_precision_modifier(fmt + index, &index);
-            switch(*(fmt + index)) {
-                case 'b':
-                    ex_print_binary_to_stream(stream, (int) va_arg(args, int) );
-                    break;
-                case 'i':   
-                    if(wid)
-                        ex_print_number_to_stream(stream, (float) va_arg(args, int), wid, 0 );
-                    else
-                        stream->print((int) va_arg(args, int));
-                    break;
-
-                case 'f':
-                    if( ( wid > 0 ) && ( prec >= 0 ) ) {
-                        ex_print_number_to_stream(stream, (float) va_arg(args, double), wid, prec);
-                    }
-                    else if( ( prec > 0 ) && ( wid == 0 ) ) {
-                        stream->print((float) va_arg(args, double), prec);
-                    }
-                    else {
-                        stream->print((float) va_arg(args, double));
-                    }
-                    break;
-                case 's':
-                    ex_print_str_to_stream(stream, (const char *) va_arg(args, const char*),false, wid);
-                    break;
-                case 'S':
-                    ex_print_str_to_stream(stream, (const char *) va_arg(args, const char*),true, wid);
-                    break;
-                default:
-                    stream->write(*(fmt + index));
-                    break;    
-            }
-         }
-         else
-            stream->write(*(fmt + index));
-    }
+ExParseStatus ex_parse_fixed(const char* buf, uint8_t* pos, uint8_t len, bool sign, ExFixedValue* result) {
+    uint8_t p = *pos;
+    uint8_t end = p + len;
 
-    va_end(args);
-
-}
+    bool minus = false;
+    bool dot = false;
+    bool digits = false;
 
-int get_width_modifier(const char* modifier, int *index) {
-    int value = 0;
+    int32_t value = 0;
+    uint8_t dec = 0;
 
-    while(*modifier >= '0' && *modifier <= '9') {
-        (*index)++;
+    if( sign && ( buf[p] == '-' || buf[p] == '+' ) ) 
+        minus = ( buf[p++] == '-' );
 
-        value *= 10;
-        value += (*modifier - '0');
-        modifier++;
-    }
-
-    return value;
-}
+    for( ; p < end; p++ ) {
+        char ch = buf[p];
 
-int get_precision_modifier(const char* modifier, int *index) {
-    int value = 0;
-    
-    if ( *modifier != '.' )
-        return (-1);
+        if( ch == '.' && !dot ) {
+            dot = true;
+            continue;
+        }
 
-    modifier++;
-    (*index)++;
+        if( ch < '0' || ch > '9' ) break;
 
-    if ( *modifier <= '0' || *modifier > '9' ) {
-        if (*modifier == '0') 
-            (*index)++;
-        return (0);
-    }
+        digits = true;
 
-    while( *modifier >= '0' && *modifier <= '9' ) {
-        (*index)++;
+        // the decimals beyond the precision are dropped
+        if( value > ( INT32_MAX - 9 ) / 10 || dec >= EX_MAX_DECIMALS ) {
+            if( !dot ) return EX_PARSE_OVERFLOW;
+            continue;
+        }
 
-        value *= 10;
-		value += (*modifier - '0');
-		modifier++;
+        value = value * 10 + ( ch - '0' );
+        if( dot ) dec++;
     }
 
-    return value;
-}
-
-float ex_parse_float(char* input_buf, int startpos, int len) {
-    char * buf = malloc(len);
-
-    memcpy(buf, input_buf + startpos, len);
-    float result  = atof(buf);
+    if( !digits ) return EX_PARSE_EMPTY;
 
-    free(buf);
+    result->value = minus ? -value : value;
+    result->dec = dec;
+    *pos = p;
 
-    return result;
+    return EX_PARSE_OK;
 }
 
 float ex_fast_sine(int angle) {
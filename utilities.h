@@ -4,12 +4,11 @@
 #include <Arduino.h>
 #include <Print.h>
 
-extern void ex_print_number_to_buf(char* _buf, float val, int len, int dec = 0, int base = DEC, bool unsgn = false );
-extern void ex_print_number_to_stream(Print* stream, float val, int len, int dec = 0);
-extern void ex_printf_to_stream(Print* stream, const char* fmt, ...);
+// renders the fixed point value, val / 10^dec, into the buffer of len + 2 symbols, right aligned in len symbols
+// plus the dot. The high digits not fitting are dropped, the minus is dropped if unsgn is true
+extern void ex_print_number_to_buf(char* _buf, long val, int len, int dec = 0, int base = DEC, bool unsgn = false );
 extern void ex_print_binary_to_stream(Print* stream,  uint8_t val); 
 extern void ex_print_str_to_stream(Print* stream, const char* str, bool pgm = false, int fix_len = 0);
-extern float ex_parse_float(char* input_buf, int startpos, int len);
 
 const PROGMEM int SINEX10000[] = {
     0, 175, 349, 523, 698, 872, 1045, 1219, 1392, 1564, 1736, 1908, 2079, 2249, 2419, 2588,
@@ -22,4 +21,137 @@ const PROGMEM int SINEX10000[] = {
 
 extern float ex_fast_sine(int angle);
 
+#define EX_MAX_NUMBER_LEN 17
+
+// renders the fixed point value with dec decimals into buf right aligned in width symbols plus the dot,
+// width 0 - no alignment. The high digits not fitting the width are dropped. Returns the length
+extern uint8_t ex_format_fixed(char* buf, long value, uint8_t width, uint8_t dec);
+extern void ex_print_fixed(Print* stream, long value, uint8_t width, uint8_t dec);
+
+constexpr long ex_pow10(uint8_t dec) { return dec ? 10L * ex_pow10(dec - 1) : 1L; }
+
+// divides the value by 10 and returns the remainder. AVR has no divider, so the quotient is the product with
+// the reciprocal: 0xCCCD / 2^19 for 16 bits, the shifts and adds of 0.8 / 8 above
+inline uint8_t ex_divmod10(uint32_t* value) {
+    uint32_t n = *value;
+    uint32_t q;
+
+    if( n <= UINT16_MAX ) {
+        q = ( n * 0xCCCDUL ) >> 19;     // exact below 81920
+    }
+    else {
+        q = ( n >> 1 ) + ( n >> 2 );
+        q += q >> 4;
+        q += q >> 8;
+        q += q >> 16;
+        q >>= 3;                        // may be 1 less than the quotient
+    }
+
+    uint8_t r = n - ( ( q << 3 ) + ( q << 1 ) );
+    if( r > 9 ) {
+        q++;
+        r -= 10;
+    }
+
+    *value = q;
+    return r;
+}
+
+// the decimal digits of the value packed into the nibbles, the lowest digit in the lowest nibble
+extern uint32_t ex_to_bcd(uint16_t value);
+
+#define EX_MAX_DECIMALS 9       // decimals kept by the parser, the rest is dropped
+
+enum ExParseStatus {
+    EX_PARSE_OK,
+    EX_PARSE_EMPTY,             // no digits
+    EX_PARSE_OVERFLOW           // the integer part does not fit 32 bits, i.e. is above 2147483639
+};
+
+// parsed number, value / 10^dec
+struct ExFixedValue {
+    int32_t value;
+    uint8_t dec;
+};
+
+// parses the number of up to len symbols at buf + *pos, the leading sign is only accepted if sign is true.
+// Stops at the first symbol not being a part of the number and moves *pos past the number on success
+extern ExParseStatus ex_parse_fixed(const char* buf, uint8_t* pos, uint8_t len, bool sign, ExFixedValue* result);
+
+inline float ex_fixed_to_float(ExFixedValue fixed) { return fixed.value / (float) ex_pow10(fixed.dec); }
+
+// Fields of ex_format. The width and the decimals are template params, so the format is resolved at
+// compile time, e.g. ex_format(stream, '(', ex_fixed<4,1>(vac), ' ', ex_int<3>(load), "\r\n");
+template<uint8_t W, uint8_t D> struct ExFixed { float value; };     // like %W.Df
+template<uint8_t W> struct ExInt { long value; };                   // like %Wi
+template<uint8_t W> struct ExStr { const char* str; bool pgm; };    // like %Ws or %WS
+struct ExBin { uint8_t value; };                                    // like %b
+
+template<uint8_t W, uint8_t D = 0> inline ExFixed<W, D> ex_fixed(float value) { return { value }; }
+template<uint8_t W> inline ExInt<W> ex_int(long value) { return { value }; }
+template<uint8_t W> inline ExStr<W> ex_str(const char* str) { return { str, false }; }
+template<uint8_t W> inline ExStr<W> ex_pstr(const char* str) { return { str, true }; }
+inline ExBin ex_bin(uint8_t value) { return { value }; }
+
+// literals, chars and integers are printed as is
+template<typename T> inline void ex_emit(Print* stream, T value) { stream->print(value); }
+
+template<uint8_t W, uint8_t D> inline void ex_emit(Print* stream, ExFixed<W, D> field) {
+    float scaled = field.value * ex_pow10(D);
+
+    // the value out of the long range is left to Print
+    if( fabs(scaled) >= 2.0E9F ) {
+        stream->print(field.value, D);
+        return;
+    }
+
+    // the fields of a width are truncated like by the former renderer and the display, e.g. 13.596 is 13.59 in
+    // the QBV and on the LCD. The free ones are rounded like by Print, so the params read back as they are set
+    if( !W ) scaled += ( scaled < 0 ? -0.5F : 0.5F );
+
+    ex_print_fixed(stream, (long) scaled, W, D);
+}
+
+template<uint8_t W> inline void ex_emit(Print* stream, ExInt<W> field) { ex_print_fixed(stream, field.value, W, 0); }
+template<uint8_t W> inline void ex_emit(Print* stream, ExStr<W> field) { ex_print_str_to_stream(stream, field.str, field.pgm, W); }
+inline void ex_emit(Print* stream, ExBin field) { ex_print_binary_to_stream(stream, field.value); }
+
+// floats without the field are printed with 2 decimals, like %f
+inline void ex_emit(Print* stream, float value) { ex_emit(stream, ex_fixed<0, 2>(value)); }
+inline void ex_emit(Print* stream, double value) { ex_emit(stream, ex_fixed<0, 2>(value)); }
+
+// prints the arguments in order
+inline void ex_format(Print*) {}
+
+template<typename T, typename... Args> inline void ex_format(Print* stream, T first, Args... rest) {
+    ex_emit(stream, first);
+    ex_format(stream, rest...);
+}
+
+/**
+ * @brief BufferPrint allows to format into a char buffer, e.g. to render a response in advance.
+ *        The output exceeding the buffer is dropped, the buffer is always null terminated.
+ */
+class BufferPrint : public Print {
+    public:
+        BufferPrint(char* buf, size_t size) { _buf = buf; _size = size; clear(); };
+
+        size_t write(uint8_t ch) override {
+            if( _len + 1 >= _size ) return 0;
+            _buf[_len++] = ch;
+            _buf[_len] = '\0';
+            return 1;
+        };
+
+        using Print::write;
+
+        void clear() { _len = 0; _buf[0] = '\0'; };
+        size_t length() { return _len; };
+
+    private:
+        char* _buf;
+        size_t _size;
+        size_t _len;
+};
+
 #endif